@@ -0,0 +1,308 @@
+// Replays a query log against a SearchServer built from a corpus dump and reports throughput,
+// latency percentiles and a checksum of the results. Build together with the search-server sources
+// except main.cpp:
+//     g++ -std=c++20 -O2 -pthread -I../search-server main.cpp $(ls ../search-server/*.cpp | grep -v /main.cpp)
+// Usage: load-test CORPUS QUERY_LOG [--threads N] [--qps Q] [--repeat N] [--stop-words "..."] [--request-queue]
+//
+// CORPUS has one document per line in the format of the query server's ADD request:
+//     <document_id> <ACTUAL|IRRELEVANT|BANNED|REMOVED> <ratings|-> <text>
+// QUERY_LOG has one raw query per line. Queries the server rejects (std::invalid_argument, e.g. "--bad")
+// are reported as invalid and enter the checksum as a fixed value.
+//
+// Without --qps the threads send queries back to back (closed loop). With --qps the queries are
+// scheduled at a fixed total rate regardless of how fast answers come (open loop). A query that
+// starts late because every thread was busy would hide the wait if timed from its actual start
+// (coordinated omission), so open loop latency is measured from the scheduled time; the service
+// time from the actual start is reported separately.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_duration.h"
+#include "request_queue.h"
+#include "search_server.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string corpus_path;
+    std::string query_log_path;
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // Zero means closed loop
+    double qps = 0.0;
+    size_t repeat = 1;
+    std::string stop_words;
+    bool use_request_queue = false;
+};
+
+struct QueryTiming {
+    // From the scheduled time in open loop, from the actual start in closed loop
+    Clock::duration latency{};
+    Clock::duration service_time{};
+    uint64_t checksum = 0;
+    bool is_empty = false;
+    // The server rejected the query (std::invalid_argument)
+    bool is_error = false;
+};
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 == argc) {
+                throw std::invalid_argument(argument + " needs a value"s);
+            }
+            return argv[++i];
+        };
+        if (argument == "--threads"s) {
+            options.thread_count = std::stoul(value());
+        }
+        else if (argument == "--qps"s) {
+            options.qps = std::stod(value());
+        }
+        else if (argument == "--repeat"s) {
+            options.repeat = std::stoul(value());
+        }
+        else if (argument == "--stop-words"s) {
+            options.stop_words = value();
+        }
+        else if (argument == "--request-queue"s) {
+            options.use_request_queue = true;
+        }
+        else {
+            positional.push_back(argument);
+        }
+    }
+    if (positional.size() != 2 || options.thread_count == 0 || options.qps < 0.0) {
+        throw std::invalid_argument("Usage: load-test CORPUS QUERY_LOG [--threads N] [--qps Q] [--repeat N] "
+            "[--stop-words \"...\"] [--request-queue]"s);
+    }
+    options.corpus_path = positional[0];
+    options.query_log_path = positional[1];
+    return options;
+}
+
+std::ifstream OpenFile(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Cannot open "s + path);
+    }
+    return input;
+}
+
+DocumentStatus ParseStatus(const std::string& text) {
+    const std::string names[] = { "ACTUAL"s, "IRRELEVANT"s, "BANNED"s, "REMOVED"s };
+    for (size_t status = 0; status < std::size(names); ++status) {
+        if (names[status] == text) {
+            return static_cast<DocumentStatus>(status);
+        }
+    }
+    throw std::invalid_argument("Invalid document status "s + text);
+}
+
+std::vector<int> ParseRatings(const std::string& text) {
+    std::vector<int> ratings;
+    if (text == "-"s) {
+        return ratings;
+    }
+    std::istringstream input(text);
+    for (std::string rating; std::getline(input, rating, ',');) {
+        ratings.push_back(std::stoi(rating));
+    }
+    return ratings;
+}
+
+size_t LoadCorpus(const std::string& path, SearchServer& search_server) {
+    std::ifstream input = OpenFile(path);
+    size_t line_number = 0;
+    for (std::string line; std::getline(input, line);) {
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        int document_id = 0;
+        std::string status;
+        std::string ratings;
+        if (!(fields >> document_id >> status >> ratings)) {
+            throw std::invalid_argument(path + ":"s + std::to_string(line_number) + ": malformed document"s);
+        }
+        std::string text;
+        std::getline(fields >> std::ws, text);
+        search_server.AddDocument(document_id, text, ParseStatus(status), ParseRatings(ratings));
+    }
+    return static_cast<size_t>(search_server.GetDocumentCount());
+}
+
+std::vector<std::string> LoadQueries(const std::string& path) {
+    std::ifstream input = OpenFile(path);
+    std::vector<std::string> queries;
+    for (std::string line; std::getline(input, line);) {
+        queries.push_back(line);
+    }
+    return queries;
+}
+
+uint64_t MixHash(uint64_t hash, uint64_t value) {
+    // FNV-1a over the 8 bytes of the value
+    for (int byte = 0; byte < 8; ++byte) {
+        hash ^= (value >> (byte * 8)) & 0xFF;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Relevance is rounded to COMPARISON_ACCURACY_FOR_DOUBLE, so builds that agree on the ranking
+// agree on the checksum
+// Checksum of a rejected query; differs from that of an empty result, so the two are told apart
+constexpr uint64_t ERROR_CHECKSUM = 0;
+
+uint64_t ComputeChecksum(const std::vector<Document>& documents) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const Document& document : documents) {
+        hash = MixHash(hash, static_cast<uint64_t>(document.id));
+        hash = MixHash(hash, static_cast<uint64_t>(document.rating));
+        hash = MixHash(hash, static_cast<uint64_t>(std::llround(document.relevance / SearchServer::COMPARISON_ACCURACY_FOR_DOUBLE)));
+    }
+    return hash;
+}
+
+double ToMilliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void PrintPercentiles(const std::string& title, std::vector<Clock::duration> durations) {
+    std::sort(durations.begin(), durations.end());
+    std::cout << title << " ms:";
+    for (const double percentile : { 50.0, 90.0, 99.0, 99.9 }) {
+        const size_t index = std::min(durations.size() - 1,
+            static_cast<size_t>(std::ceil(percentile / 100.0 * durations.size())) - 1);
+        std::cout << " p" << percentile << "=" << ToMilliseconds(durations[index]);
+    }
+    std::cout << " max=" << ToMilliseconds(durations.back()) << std::endl;
+}
+
+void RunLoad(const Options& options, const SearchServer& search_server, const std::vector<std::string>& queries) {
+    const size_t total_count = queries.size() * options.repeat;
+    std::vector<QueryTiming> timings(total_count);
+    std::atomic<size_t> next_query = 0;
+    std::atomic<size_t> late_count = 0;
+    const Clock::time_point start = Clock::now();
+
+    const auto worker = [&]() {
+        RequestQueue request_queue(search_server);
+        for (size_t index = next_query++; index < total_count; index = next_query++) {
+            Clock::time_point scheduled = Clock::now();
+            if (options.qps > 0.0) {
+                scheduled = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(index / options.qps));
+                if (scheduled > Clock::now()) {
+                    std::this_thread::sleep_until(scheduled);
+                }
+                else if (Clock::now() - scheduled > std::chrono::milliseconds(1)) {
+                    ++late_count;
+                }
+            }
+            const std::string& query = queries[index % queries.size()];
+            QueryTiming& timing = timings[index];
+            const Clock::time_point query_start = Clock::now();
+            // A malformed query in the log is counted, not allowed to escape the thread and terminate the run
+            try {
+                const std::vector<Document> documents = options.use_request_queue
+                    ? request_queue.AddFindRequest(query)
+                    : search_server.FindTopDocuments(query);
+                timing.checksum = ComputeChecksum(documents);
+                timing.is_empty = documents.empty();
+            }
+            catch (const std::invalid_argument&) {
+                timing.checksum = ERROR_CHECKSUM;
+                timing.is_error = true;
+            }
+            const Clock::time_point query_end = Clock::now();
+
+            timing.latency = query_end - (options.qps > 0.0 ? scheduled : query_start);
+            timing.service_time = query_end - query_start;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < options.thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const Clock::duration elapsed = Clock::now() - start;
+
+    // Combined in log order, so the checksum doesn't depend on thread scheduling
+    uint64_t checksum = 14695981039346656037ull;
+    size_t empty_count = 0;
+    size_t error_count = 0;
+    std::vector<Clock::duration> latencies;
+    std::vector<Clock::duration> service_times;
+    for (const QueryTiming& timing : timings) {
+        checksum = MixHash(checksum, timing.checksum);
+        empty_count += timing.is_empty ? 1 : 0;
+        error_count += timing.is_error ? 1 : 0;
+        latencies.push_back(timing.latency);
+        service_times.push_back(timing.service_time);
+    }
+
+    std::cout << "Mode: ";
+    if (options.qps > 0.0) {
+        std::cout << "open loop at " << options.qps << " qps";
+    }
+    else {
+        std::cout << "closed loop";
+    }
+    std::cout << ", " << options.thread_count << " threads" << (options.use_request_queue ? ", through RequestQueue" : "")
+        << std::endl;
+    std::cout << "Queries: " << total_count << " in " << ToMilliseconds(elapsed) << " ms, "
+        << total_count / std::chrono::duration<double>(elapsed).count() << " qps" << std::endl;
+    if (total_count == 0) {
+        return;
+    }
+    PrintPercentiles(options.qps > 0.0 ? "Latency (from scheduled time, corrected for coordinated omission)"s : "Latency"s,
+        latencies);
+    if (options.qps > 0.0) {
+        PrintPercentiles("Service time"s, service_times);
+        std::cout << "Started more than 1 ms behind schedule: " << late_count << std::endl;
+    }
+    std::cout << "Empty results: " << empty_count << std::endl;
+    std::cout << "Invalid queries: " << error_count << std::endl;
+    std::cout << "Result checksum: " << std::hex << std::setw(16) << std::setfill('0') << checksum << std::dec << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        SearchServer search_server(options.stop_words);
+        {
+            LOG_DURATION("Corpus loading"s);
+            std::cout << "Documents: " << LoadCorpus(options.corpus_path, search_server) << std::endl;
+        }
+        const std::vector<std::string> queries = LoadQueries(options.query_log_path);
+        RunLoad(options, search_server, queries);
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}
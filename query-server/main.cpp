@@ -0,0 +1,48 @@
+// Network front end for SearchServer (Linux only), see query_server.h for the protocol.
+// Build together with the search-server sources except main.cpp:
+//     g++ -std=c++20 -O2 -pthread -I../search-server main.cpp $(ls ../search-server/*.cpp | grep -v /main.cpp)
+// Usage: query-server tcp:HOST:PORT|unix:PATH ["stop words"] [thread_count]
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "query_server.h"
+#include "search_server.h"
+
+namespace {
+
+QueryServer* running_server = nullptr;
+
+void HandleStopSignal(int) {
+    if (running_server) {
+        running_server->Stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " tcp:HOST:PORT|unix:PATH [\"stop words\"] [thread_count]" << std::endl;
+        return 1;
+    }
+    try {
+        SearchServer search_server(std::string(argc >= 3 ? argv[2] : ""));
+        QueryServerOptions options;
+        if (argc == 4) {
+            options.thread_count = std::stoul(argv[3]);
+        }
+        QueryServer query_server(search_server, Endpoint::Parse(argv[1]), options);
+        running_server = &query_server;
+        std::signal(SIGINT, HandleStopSignal);
+        std::signal(SIGTERM, HandleStopSignal);
+        std::cout << "Listening on " << query_server.GetEndpoint().ToString() << std::endl;
+        query_server.Serve();
+        running_server = nullptr;
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}
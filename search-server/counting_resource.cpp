@@ -0,0 +1,24 @@
+#include "counting_resource.h"
+
+CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+    : upstream_(upstream) {
+}
+
+size_t CountingResource::GetAllocatedBytes() const {
+    return allocated_bytes_.load(std::memory_order_relaxed);
+}
+
+void* CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    void* pointer = upstream_->allocate(bytes, alignment);
+    allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return pointer;
+}
+
+void CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    upstream_->deallocate(pointer, bytes, alignment);
+    allocated_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,39 @@
+#include <algorithm>
+
+#include "document_bitmap.h"
+
+DocumentBitmap::DocumentBitmap(std::pmr::memory_resource* resource)
+    : words_(resource) {
+}
+
+void DocumentBitmap::Set(int ordinal) {
+    const size_t word = static_cast<size_t>(ordinal) / BITS_PER_WORD;
+    if (word >= words_.size()) {
+        words_.resize(word + 1);
+    }
+    words_[word] |= uint64_t{ 1 } << (ordinal % BITS_PER_WORD);
+}
+
+void DocumentBitmap::Reset(int ordinal) {
+    const size_t word = static_cast<size_t>(ordinal) / BITS_PER_WORD;
+    if (word < words_.size()) {
+        words_[word] &= ~(uint64_t{ 1 } << (ordinal % BITS_PER_WORD));
+    }
+}
+
+void DocumentBitmap::Clear() {
+    std::fill(words_.begin(), words_.end(), 0);
+}
+
+void DocumentBitmap::Union(const DocumentBitmap& other) {
+    if (other.words_.size() > words_.size()) {
+        words_.resize(other.words_.size());
+    }
+    for (size_t word = 0; word < other.words_.size(); ++word) {
+        words_[word] |= other.words_[word];
+    }
+}
+
+size_t DocumentBitmap::GetMemoryUsage() const {
+    return words_.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Set of internal document ordinals, one bit per document
+class DocumentBitmap {
+public:
+    explicit DocumentBitmap(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Grows the bitmap when the ordinal is out of range
+    void Set(int ordinal);
+
+    void Reset(int ordinal);
+
+    bool Test(int ordinal) const {
+        const size_t word = static_cast<size_t>(ordinal) / BITS_PER_WORD;
+        return word < words_.size() && (words_[word] >> (ordinal % BITS_PER_WORD) & 1u);
+    }
+
+    void Clear();
+
+    // Sets every ordinal set in the other bitmap
+    void Union(const DocumentBitmap& other);
+
+    size_t GetMemoryUsage() const;
+
+private:
+    inline static constexpr int BITS_PER_WORD = 64;
+
+    std::pmr::vector<uint64_t> words_;
+};
@@ -0,0 +1,45 @@
+#include "document_predicates.h"
+
+IdSet::IdSet(std::initializer_list<int> ids)
+    : IdSet(std::vector<int>(ids)) {
+}
+
+const std::vector<int>& IdSet::GetIds() const {
+    return ids_;
+}
+
+DocumentFilter::DocumentFilter(std::pmr::memory_resource* resource)
+    : ids(resource) {
+}
+
+bool DocumentFilter::HasRatingRange() const {
+    return min_rating != std::numeric_limits<int>::min() || max_rating != std::numeric_limits<int>::max();
+}
+
+void AddToFilter(const StatusEquals& predicate, DocumentFilter& filter) {
+    if (filter.status && *filter.status != predicate.status) {
+        filter.matches_nothing = true;
+    }
+    filter.status = predicate.status;
+}
+
+void AddToFilter(const RatingRange& predicate, DocumentFilter& filter) {
+    filter.min_rating = std::max(filter.min_rating, predicate.min_rating);
+    filter.max_rating = std::min(filter.max_rating, predicate.max_rating);
+    if (filter.min_rating > filter.max_rating) {
+        filter.matches_nothing = true;
+    }
+}
+
+void AddToFilter(const IdSet& predicate, DocumentFilter& filter) {
+    const auto& ids = predicate.GetIds();
+    if (!filter.has_ids) {
+        filter.has_ids = true;
+        filter.ids.assign(ids.begin(), ids.end());
+        return;
+    }
+    const auto intersection_end = std::remove_if(filter.ids.begin(), filter.ids.end(), [&ids](int id) {
+        return !std::binary_search(ids.begin(), ids.end(), id);
+        });
+    filter.ids.erase(intersection_end, filter.ids.end());
+}
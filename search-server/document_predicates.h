@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "document.h"
+
+// Predicates that SearchServer recognizes at compile time and evaluates with specialized
+// kernels instead of calling them for every posting. They are ordinary predicates too,
+// so they can be passed anywhere a (document_id, status, rating) lambda is accepted.
+// Conjunctions are built with &&: StatusEquals{ DocumentStatus::ACTUAL } && RatingRange{ 0, 5 }
+
+struct StatusEquals {
+    DocumentStatus status;
+
+    bool operator()(int document_id, DocumentStatus document_status, int rating) const {
+        return document_status == status;
+    }
+};
+
+// Both bounds are inclusive
+struct RatingRange {
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+
+    bool operator()(int document_id, DocumentStatus document_status, int rating) const {
+        return rating >= min_rating && rating <= max_rating;
+    }
+};
+
+class IdSet {
+public:
+    template <typename IdContainer>
+    explicit IdSet(const IdContainer& ids);
+
+    IdSet(std::initializer_list<int> ids);
+
+    bool operator()(int document_id, DocumentStatus document_status, int rating) const {
+        return std::binary_search(ids_.begin(), ids_.end(), document_id);
+    }
+
+    // Sorted and unique
+    const std::vector<int>& GetIds() const;
+
+private:
+    std::vector<int> ids_;
+};
+
+template <typename Lhs, typename Rhs>
+struct AllOf {
+    Lhs lhs;
+    Rhs rhs;
+
+    bool operator()(int document_id, DocumentStatus document_status, int rating) const {
+        return lhs(document_id, document_status, rating) && rhs(document_id, document_status, rating);
+    }
+};
+
+template <typename Predicate>
+struct IsIndexPredicate : std::false_type {};
+
+template <>
+struct IsIndexPredicate<StatusEquals> : std::true_type {};
+
+template <>
+struct IsIndexPredicate<RatingRange> : std::true_type {};
+
+template <>
+struct IsIndexPredicate<IdSet> : std::true_type {};
+
+template <typename Lhs, typename Rhs>
+struct IsIndexPredicate<AllOf<Lhs, Rhs>>
+    : std::bool_constant<IsIndexPredicate<Lhs>::value && IsIndexPredicate<Rhs>::value> {};
+
+template <typename Lhs, typename Rhs,
+    typename = std::enable_if_t<IsIndexPredicate<Lhs>::value && IsIndexPredicate<Rhs>::value>>
+AllOf<Lhs, Rhs> operator&&(const Lhs& lhs, const Rhs& rhs) {
+    return { lhs, rhs };
+}
+
+// Index predicate folded into plain constraints; an empty filter lets every document through
+struct DocumentFilter {
+    explicit DocumentFilter(std::pmr::memory_resource* resource);
+
+    std::optional<DocumentStatus> status;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    bool has_ids = false;
+    std::pmr::vector<int> ids;
+    // Set when the constraints contradict each other, e.g. two different statuses
+    bool matches_nothing = false;
+
+    bool HasRatingRange() const;
+};
+
+void AddToFilter(const StatusEquals& predicate, DocumentFilter& filter);
+
+void AddToFilter(const RatingRange& predicate, DocumentFilter& filter);
+
+void AddToFilter(const IdSet& predicate, DocumentFilter& filter);
+
+template <typename Lhs, typename Rhs>
+void AddToFilter(const AllOf<Lhs, Rhs>& predicate, DocumentFilter& filter) {
+    AddToFilter(predicate.lhs, filter);
+    AddToFilter(predicate.rhs, filter);
+}
+
+template <typename IdContainer>
+IdSet::IdSet(const IdContainer& ids)
+    : ids_(ids.begin(), ids.end()) {
+    std::sort(ids_.begin(), ids_.end());
+    ids_.erase(std::unique(ids_.begin(), ids_.end()), ids_.end());
+}
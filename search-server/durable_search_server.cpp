@@ -0,0 +1,172 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "durable_search_server.h"
+#include "shard_protocol.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+[[noreturn]] void ThrowSystemError(const std::string& action) {
+    throw std::runtime_error(action + ": "s + std::strerror(errno));
+}
+
+// Makes a written file, or a rename in a directory, durable
+void SyncPath(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ThrowSystemError("open "s + path);
+    }
+    const int result = fsync(fd);
+    close(fd);
+    if (result < 0) {
+        ThrowSystemError("fsync "s + path);
+    }
+}
+
+}  // namespace
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, const std::string& stop_words_text,
+    MutationLogOptions options)
+    : snapshot_path_(directory + "/snapshot"s)
+    , log_path_(directory + "/log"s)
+    , index_(stop_words_text) {
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        ThrowSystemError("mkdir "s + directory);
+    }
+
+    // The snapshot starts with the sequence number of the last update it contains
+    std::ifstream snapshot(snapshot_path_, std::ios::binary);
+    if (snapshot) {
+        std::string header(8, '\0');
+        if (!snapshot.read(header.data(), header.size())) {
+            throw std::runtime_error("Snapshot is truncated"s);
+        }
+        last_sequence_ = MessageReader(header).ReadUint64();
+        index_.LoadSnapshot(snapshot);
+    }
+
+    // Records up to the snapshot are left in the log if the last checkpoint crashed before emptying it
+    const uint64_t snapshot_sequence = last_sequence_;
+    const size_t valid_size = MutationLog::Replay(log_path_, [this, snapshot_sequence](const Mutation& mutation) {
+        if (mutation.sequence > snapshot_sequence) {
+            Apply(mutation);
+            last_sequence_ = mutation.sequence;
+            ++replayed_count_;
+        }
+        });
+    log_ = std::make_unique<MutationLog>(log_path_, valid_size, last_sequence_ + 1, options);
+}
+
+void DurableSearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+    const std::vector<int>& ratings) {
+    std::unique_lock lock(index_mutex_);
+    ThrowIfFailed();
+    // Applied first, so an update the index rejects is never logged
+    index_.AddDocument(document_id, document, status, ratings);
+    Mutation mutation;
+    mutation.type = MutationType::ADD_DOCUMENT;
+    mutation.document_id = document_id;
+    mutation.text = document;
+    mutation.status = status;
+    mutation.ratings = ratings;
+    Log(lock, std::move(mutation));
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    std::unique_lock lock(index_mutex_);
+    ThrowIfFailed();
+    if (!index_.HasDocument(document_id)) {
+        return;
+    }
+    index_.RemoveDocument(document_id);
+    Mutation mutation;
+    mutation.type = MutationType::REMOVE_DOCUMENT;
+    mutation.document_id = document_id;
+    Log(lock, std::move(mutation));
+}
+
+void DurableSearchServer::Checkpoint() {
+    std::lock_guard checkpoint_guard(checkpoint_mutex_);
+    std::shared_lock lock(index_mutex_);
+    // The index may hold updates the log lost
+    ThrowIfFailed();
+
+    const std::string temporary_path = snapshot_path_ + ".tmp"s;
+    {
+        std::ofstream snapshot(temporary_path, std::ios::binary | std::ios::trunc);
+        MessageWriter header;
+        header.WriteUint64(last_sequence_);
+        snapshot.write(header.GetData().data(), header.GetData().size());
+        index_.SaveSnapshot(snapshot);
+        snapshot.close();
+        if (!snapshot) {
+            throw std::runtime_error("Cannot write "s + temporary_path);
+        }
+    }
+    SyncPath(temporary_path);
+    if (rename(temporary_path.c_str(), snapshot_path_.c_str()) < 0) {
+        ThrowSystemError("rename "s + temporary_path);
+    }
+    SyncPath(snapshot_path_.substr(0, snapshot_path_.rfind('/')));
+
+    // No update can be appended while the lock is held, so every logged record is in the snapshot
+    log_->Truncate();
+}
+
+std::vector<Document> DurableSearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, StatusEquals{ status });
+}
+
+std::vector<Document> DurableSearchServer::FindTopDocuments(const std::string& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> DurableSearchServer::MatchDocument(const std::string& raw_query,
+    int document_id) const {
+    std::shared_lock lock(index_mutex_);
+    return index_.MatchDocument(raw_query, document_id);
+}
+
+int DurableSearchServer::GetDocumentCount() const {
+    std::shared_lock lock(index_mutex_);
+    return index_.GetDocumentCount();
+}
+
+size_t DurableSearchServer::GetReplayedCount() const {
+    return replayed_count_;
+}
+
+void DurableSearchServer::Apply(const Mutation& mutation) {
+    if (mutation.type == MutationType::ADD_DOCUMENT) {
+        index_.AddDocument(mutation.document_id, mutation.text, mutation.status, mutation.ratings);
+    }
+    else {
+        index_.RemoveDocument(mutation.document_id);
+    }
+}
+
+void DurableSearchServer::ThrowIfFailed() const {
+    if (failed_) {
+        throw std::runtime_error("Mutation log failed, the directory must be reopened"s);
+    }
+}
+
+void DurableSearchServer::Log(std::unique_lock<std::shared_mutex>& lock, Mutation mutation) {
+    try {
+        const uint64_t sequence = last_sequence_ = log_->Append(std::move(mutation));
+        lock.unlock();
+        log_->WaitDurable(sequence);
+    }
+    catch (...) {
+        failed_ = true;
+        throw;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "mutation_log.h"
+#include "search_server.h"
+
+// SearchServer whose updates survive a restart (POSIX only). The directory holds the latest
+// snapshot of the index and the mutation log of the updates made after it; opening the directory
+// loads the snapshot and replays the log on top, so only the updates since the last Checkpoint()
+// are re-tokenized.
+// An update is applied in memory, appended to the log, and returns once the log is on disk. The index
+// lock is released before the wait, so queries and other writers never wait for the disk, and the
+// writers waiting at the same time share one sync. Queries may run concurrently with updates.
+// Queries see an update as soon as it is applied, before it is durable (read uncommitted): if the log
+// fails, an update the caller got an exception for may have been seen by queries, and it is lost on
+// reopen. After such a failure the server refuses further updates and checkpoints with
+// std::runtime_error, so the index never drifts further from the disk; reopen the directory to go on.
+class DurableSearchServer {
+public:
+    DurableSearchServer(const std::string& directory, const std::string& stop_words_text,
+        MutationLogOptions options = {});
+
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Writes a snapshot of the index and empties the log. Queries go on meanwhile, updates wait.
+    void Checkpoint();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    // Log records applied on top of the snapshot when the directory was opened
+    size_t GetReplayedCount() const;
+
+private:
+    std::string snapshot_path_;
+    std::string log_path_;
+    SearchServer index_;
+    // Exclusive for updates, shared for queries and checkpoints
+    mutable std::shared_mutex index_mutex_;
+    std::mutex checkpoint_mutex_;
+    // Sequence number of the last update applied to the index
+    uint64_t last_sequence_ = 0;
+    size_t replayed_count_ = 0;
+    std::unique_ptr<MutationLog> log_;
+    // Set once appending to the log or waiting for it failed
+    std::atomic<bool> failed_ = false;
+
+    void Apply(const Mutation& mutation);
+    void ThrowIfFailed() const;
+    // Appends to the log and waits for the disk outside the index lock
+    void Log(std::unique_lock<std::shared_mutex>& lock, Mutation mutation);
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> DurableSearchServer::FindTopDocuments(const std::string& raw_query,
+    DocumentPredicate document_predicate) const {
+    std::shared_lock lock(index_mutex_);
+    return index_.FindTopDocuments(raw_query, document_predicate);
+}
@@ -0,0 +1,218 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mutation_log.h"
+#include "shard_protocol.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+inline constexpr size_t RECORD_HEADER_SIZE = 8;
+inline constexpr uint32_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+[[noreturn]] void ThrowSystemError(const std::string& action) {
+    throw std::runtime_error(action + ": "s + std::strerror(errno));
+}
+
+// FNV-1a
+uint32_t ComputeChecksum(std::string_view data) {
+    uint32_t hash = 2166136261u;
+    for (const char byte : data) {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+std::string EncodeRecord(const Mutation& mutation) {
+    MessageWriter payload;
+    payload.WriteUint64(mutation.sequence);
+    payload.WriteByte(static_cast<uint8_t>(mutation.type));
+    payload.WriteInt(mutation.document_id);
+    if (mutation.type == MutationType::ADD_DOCUMENT) {
+        payload.WriteByte(static_cast<uint8_t>(mutation.status));
+        payload.WriteUint(static_cast<uint32_t>(mutation.ratings.size()));
+        for (const int rating : mutation.ratings) {
+            payload.WriteInt(rating);
+        }
+        payload.WriteString(mutation.text);
+    }
+    MessageWriter record;
+    record.WriteUint(static_cast<uint32_t>(payload.GetData().size()));
+    record.WriteUint(ComputeChecksum(payload.GetData()));
+    return record.GetData() + payload.GetData();
+}
+
+Mutation DecodeRecord(std::string_view payload) {
+    MessageReader reader(payload);
+    Mutation mutation;
+    mutation.sequence = reader.ReadUint64();
+    mutation.type = static_cast<MutationType>(reader.ReadByte());
+    mutation.document_id = reader.ReadInt();
+    if (mutation.type == MutationType::ADD_DOCUMENT) {
+        mutation.status = static_cast<DocumentStatus>(reader.ReadByte());
+        mutation.ratings.resize(reader.ReadUint());
+        for (int& rating : mutation.ratings) {
+            rating = reader.ReadInt();
+        }
+        mutation.text = reader.ReadString();
+    }
+    else if (mutation.type != MutationType::REMOVE_DOCUMENT) {
+        throw std::runtime_error("Unknown mutation type"s);
+    }
+    return mutation;
+}
+
+void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("write"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+}  // namespace
+
+MutationLog::MutationLog(const std::string& path, size_t valid_size, uint64_t next_sequence, MutationLogOptions options)
+    : options_(options)
+    , next_sequence_(next_sequence)
+    , durable_sequence_(next_sequence - 1) {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd_ < 0) {
+        ThrowSystemError("open "s + path);
+    }
+    // A torn record at the end would hide everything appended after it
+    if (ftruncate(fd_, static_cast<off_t>(valid_size)) < 0 || lseek(fd_, 0, SEEK_END) < 0) {
+        const int error = errno;
+        close(fd_);
+        errno = error;
+        ThrowSystemError("Cannot prepare "s + path);
+    }
+    writer_ = std::thread([this] {
+        WriteLoop();
+        });
+}
+
+MutationLog::~MutationLog() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_pending_.notify_one();
+    writer_.join();
+    close(fd_);
+}
+
+uint64_t MutationLog::Append(Mutation mutation) {
+    std::lock_guard guard(mutex_);
+    mutation.sequence = next_sequence_++;
+    pending_ += EncodeRecord(mutation);
+    has_pending_.notify_one();
+    return mutation.sequence;
+}
+
+void MutationLog::WaitDurable(uint64_t sequence) {
+    std::unique_lock lock(mutex_);
+    written_.wait(lock, [this, sequence] {
+        return durable_sequence_ >= sequence || !error_.empty();
+        });
+    if (durable_sequence_ < sequence) {
+        throw std::runtime_error("Mutation log failed: "s + error_);
+    }
+}
+
+void MutationLog::Truncate() {
+    std::unique_lock lock(mutex_);
+    written_.wait(lock, [this] {
+        return (pending_.empty() && !is_writing_) || !error_.empty();
+        });
+    if (!error_.empty()) {
+        throw std::runtime_error("Mutation log failed: "s + error_);
+    }
+    if (ftruncate(fd_, 0) < 0 || lseek(fd_, 0, SEEK_SET) < 0 || (options_.sync && fdatasync(fd_) < 0)) {
+        ThrowSystemError("Cannot truncate mutation log"s);
+    }
+}
+
+void MutationLog::WriteLoop() {
+    std::string batch;
+    std::unique_lock lock(mutex_);
+    while (true) {
+        has_pending_.wait(lock, [this] {
+            return stopping_ || !pending_.empty();
+            });
+        if (pending_.empty()) {
+            return;
+        }
+        // Records appended while this batch is written go to the next one
+        batch.swap(pending_);
+        const uint64_t last_sequence = next_sequence_ - 1;
+        is_writing_ = true;
+        lock.unlock();
+
+        std::string error;
+        try {
+            WriteAll(fd_, batch);
+            if (options_.sync && fdatasync(fd_) < 0) {
+                ThrowSystemError("fdatasync"s);
+            }
+        }
+        catch (const std::exception& write_error) {
+            error = write_error.what();
+        }
+        batch.clear();
+
+        lock.lock();
+        is_writing_ = false;
+        if (error.empty()) {
+            durable_sequence_ = last_sequence;
+        }
+        else if (error_.empty()) {
+            error_ = error;
+        }
+        written_.notify_all();
+    }
+}
+
+size_t MutationLog::Replay(const std::string& path, const std::function<void(const Mutation&)>& handler) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return 0;
+    }
+    size_t valid_size = 0;
+    std::string header(RECORD_HEADER_SIZE, '\0');
+    std::string payload;
+    while (input.read(header.data(), header.size())) {
+        MessageReader header_reader(header);
+        const uint32_t size = header_reader.ReadUint();
+        const uint32_t checksum = header_reader.ReadUint();
+        if (size > MAX_RECORD_SIZE) {
+            break;
+        }
+        payload.resize(size);
+        if (!input.read(payload.data(), size) || ComputeChecksum(payload) != checksum) {
+            break;
+        }
+        Mutation mutation;
+        try {
+            mutation = DecodeRecord(payload);
+        }
+        catch (const std::runtime_error&) {
+            break;
+        }
+        handler(mutation);
+        valid_size += RECORD_HEADER_SIZE + size;
+    }
+    return valid_size;
+}
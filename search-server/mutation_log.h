@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+enum class MutationType : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT,
+};
+
+struct Mutation {
+    uint64_t sequence = 0;
+    MutationType type = MutationType::ADD_DOCUMENT;
+    int document_id = 0;
+    // The rest is set for ADD_DOCUMENT only
+    std::string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+struct MutationLogOptions {
+    // Without fdatasync a record is durable only once the OS writes it back
+    bool sync = true;
+};
+
+// Append-only log of index mutations (POSIX only). Every record is
+//     <payload size: uint32> <checksum of the payload: uint32> <payload>
+// Appends only queue the record. A background thread writes everything queued since its last
+// round with one write() and one fdatasync(), so writers waiting for durability at the same
+// time share a sync (group commit).
+class MutationLog {
+public:
+    // Keeps the first valid_size bytes of the file (see Replay) and appends after them;
+    // the first appended record gets next_sequence
+    MutationLog(const std::string& path, size_t valid_size, uint64_t next_sequence, MutationLogOptions options = {});
+
+    MutationLog(const MutationLog&) = delete;
+    MutationLog& operator=(const MutationLog&) = delete;
+
+    // Writes the queued records before closing
+    ~MutationLog();
+
+    // Queues the record and returns its sequence number without waiting for the disk
+    uint64_t Append(Mutation mutation);
+
+    // Blocks until the record and all records before it are written (and synced, if enabled).
+    // Throws std::runtime_error if writing the log failed.
+    void WaitDurable(uint64_t sequence);
+
+    // Drops all records, e.g. after a snapshot made them unnecessary; queued records are written first
+    void Truncate();
+
+    // Calls handler for every complete record of the file in order and returns the size of the
+    // complete part. A torn or corrupt record, which a crash in the middle of a write leaves behind,
+    // ends the log. A missing file is an empty log.
+    static size_t Replay(const std::string& path, const std::function<void(const Mutation&)>& handler);
+
+private:
+    int fd_ = -1;
+    MutationLogOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable has_pending_;
+    std::condition_variable written_;
+    // Encoded records waiting for the writer thread and the sequence number of the last one
+    std::string pending_;
+    uint64_t next_sequence_;
+    uint64_t durable_sequence_;
+    bool is_writing_ = false;
+    bool stopping_ = false;
+    std::string error_;
+    std::thread writer_;
+
+    void WriteLoop();
+};
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #include "search_server.h"
@@ -30,34 +34,91 @@ private:
     size_t size_;
 };
 
+// Walks pages of [begin, end), each page is computed when the iterator moves to it.
+// Keeps the number of items after the current page, so moving on costs one page, not the rest of the range.
+template <typename Iterator>
+class PageIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = IteratorRange<Iterator>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const IteratorRange<Iterator>*;
+    using reference = const IteratorRange<Iterator>&;
+
+    // left is the number of items from page_begin to the end of the range
+    PageIterator(Iterator page_begin, size_t left, size_t page_size)
+        : page_(page_begin, next(page_begin, std::min(page_size, left)))
+        , left_(left - page_.size())
+        , page_size_(page_size)
+    {
+    }
+
+    const IteratorRange<Iterator>& operator*() const {
+        return page_;
+    }
+
+    const IteratorRange<Iterator>* operator->() const {
+        return &page_;
+    }
+
+    PageIterator& operator++() {
+        const Iterator page_begin = page_.end();
+        const size_t page_size = std::min(page_size_, left_);
+        page_ = { page_begin, next(page_begin, page_size) };
+        left_ -= page_size;
+        return *this;
+    }
+
+    PageIterator operator++(int) {
+        PageIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(const PageIterator& other) const {
+        return page_.begin() == other.page_.begin();
+    }
+
+    bool operator!=(const PageIterator& other) const {
+        return !(*this == other);
+    }
+
+private:
+    IteratorRange<Iterator> page_;
+    size_t left_;
+    size_t page_size_;
+};
+
+// Lazy: no page is stored, pages are computed while iterating.
+// Throws std::invalid_argument if page_size is 0.
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = next(begin, current_page_size);
-            pages_vector_.push_back({ begin, current_page_end });
-
-            left -= current_page_size;
-            begin = current_page_end;
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin), end_(end), item_count_(distance(begin, end)), page_size_(page_size)
+    {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive"s);
         }
     }
 
-    auto begin() const {
-        return pages_vector_.begin();
+    PageIterator<Iterator> begin() const {
+        return { begin_, item_count_, page_size_ };
     }
 
-    auto end() const {
-        return pages_vector_.end();
+    PageIterator<Iterator> end() const {
+        return { end_, 0, page_size_ };
     }
 
     size_t size() const {
-        return pages_vector_.size();
+        return (item_count_ + page_size_ - 1) / page_size_;
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_vector_;
+    Iterator begin_;
+    Iterator end_;
+    size_t item_count_;
+    size_t page_size_;
 };
 
 template <typename Container>
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// Postings of one word as (ordinal, term frequency) pairs sorted by ordinal in one array.
+// Not allocator-aware on purpose: the index gives posting arrays their own resource.
+// Has the part of the std::map interface the index uses: lookups are O(log n) and an append,
+// the usual insertion since new documents get the largest ordinal, is amortized O(1).
+// Erasing doesn't shift the tail: the posting stays in place as ~ordinal (a tombstone) and the
+// iterators skip it. Tombstones are dropped in one pass once they make up half of the array,
+// so an erase is amortized O(log n) too. Inserting a smaller ordinal still shifts the tail.
+template <typename TermFrequency>
+class PostingList {
+public:
+    using value_type = std::pair<int, TermFrequency>;
+
+    // Forward iterator over the live postings
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PostingList::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return *position_;
+        }
+
+        pointer operator->() const {
+            return position_;
+        }
+
+        const_iterator& operator++() {
+            ++position_;
+            SkipRemoved();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return position_ == other.position_;
+        }
+
+    private:
+        friend class PostingList;
+
+        const_iterator(pointer position, pointer end)
+            : position_(position), end_(end) {
+            SkipRemoved();
+        }
+
+        void SkipRemoved() {
+            while (position_ != end_ && position_->first < 0) {
+                ++position_;
+            }
+        }
+
+        pointer position_ = nullptr;
+        pointer end_ = nullptr;
+    };
+
+    explicit PostingList(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : postings_(resource) {
+    }
+
+    const_iterator begin() const {
+        return MakeIterator(postings_.begin());
+    }
+
+    const_iterator end() const {
+        return MakeIterator(postings_.end());
+    }
+
+    // Live postings only
+    size_t size() const {
+        return postings_.size() - removed_count_;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    const_iterator lower_bound(int ordinal) const {
+        return MakeIterator(LowerBound(ordinal));
+    }
+
+    const_iterator find(int ordinal) const {
+        const auto posting = LowerBound(ordinal);
+        return posting != postings_.end() && posting->first == ordinal ? MakeIterator(posting) : end();
+    }
+
+    size_t count(int ordinal) const {
+        return find(ordinal) != end() ? 1 : 0;
+    }
+
+    // Inserts a zero frequency if the ordinal is missing; O(n) unless the ordinal is the largest
+    // or was erased since the last compaction
+    TermFrequency& operator[](int ordinal) {
+        if (postings_.empty() || Ordinal(postings_.back()) < ordinal) {
+            return postings_.emplace_back(ordinal, TermFrequency{}).second;
+        }
+        const auto posting = postings_.begin() + (LowerBound(ordinal) - postings_.cbegin());
+        if (posting != postings_.end() && Ordinal(*posting) == ordinal) {
+            if (posting->first < 0) {
+                *posting = { ordinal, TermFrequency{} };
+                --removed_count_;
+            }
+            return posting->second;
+        }
+        return postings_.emplace(posting, ordinal, TermFrequency{})->second;
+    }
+
+    // Unlike std::map, overwrites the frequency of an existing ordinal
+    void emplace(int ordinal, TermFrequency term_freq) {
+        (*this)[ordinal] = term_freq;
+    }
+
+    void erase(int ordinal) {
+        const auto posting = postings_.begin() + (LowerBound(ordinal) - postings_.cbegin());
+        if (posting == postings_.end() || posting->first != ordinal) {
+            return;
+        }
+        posting->first = ~ordinal;
+        if (++removed_count_ * 2 > postings_.size()) {
+            RemapOrdinals([](int live_ordinal) {
+                return live_ordinal;
+            });
+        }
+    }
+
+    // Drops the tombstones and renumbers the live postings; new_ordinal must keep their order
+    template <typename OrdinalMap>
+    void RemapOrdinals(OrdinalMap new_ordinal) {
+        auto output = postings_.begin();
+        for (const value_type& posting : postings_) {
+            if (posting.first >= 0) {
+                *output++ = { new_ordinal(posting.first), posting.second };
+            }
+        }
+        postings_.erase(output, postings_.end());
+        removed_count_ = 0;
+    }
+
+private:
+    using Storage = std::pmr::vector<value_type>;
+
+    // Ordinal of a live or removed posting
+    static int Ordinal(const value_type& posting) {
+        return posting.first < 0 ? ~posting.first : posting.first;
+    }
+
+    typename Storage::const_iterator LowerBound(int ordinal) const {
+        return std::lower_bound(postings_.begin(), postings_.end(), ordinal,
+            [](const value_type& posting, int key) {
+                return Ordinal(posting) < key;
+            });
+    }
+
+    const_iterator MakeIterator(typename Storage::const_iterator position) const {
+        return const_iterator(postings_.data() + (position - postings_.begin()), postings_.data() + postings_.size());
+    }
+
+    Storage postings_;
+    size_t removed_count_ = 0;
+};
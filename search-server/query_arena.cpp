@@ -0,0 +1,61 @@
+#include <algorithm>
+
+#include "query_arena.h"
+
+QueryArena::QueryArena(size_t buffer_size, size_t max_buffer_size)
+    : buffer_(buffer_size)
+    , max_buffer_size_(std::max(buffer_size, max_buffer_size)) {
+    resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+}
+
+std::pmr::memory_resource* QueryArena::Resource() {
+    return &*resource_;
+}
+
+void QueryArena::Reset() {
+    resource_->release();
+    const size_t buffer_size = std::min(buffer_.size() + overflow_.overflow_bytes, max_buffer_size_);
+    overflow_.overflow_bytes = 0;
+    if (buffer_size > buffer_.size()) {
+        // The old contents are dead, so the buffer is replaced rather than resized
+        std::vector<std::byte>(buffer_size).swap(buffer_);
+        resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+    }
+}
+
+size_t QueryArena::GetBufferSize() const {
+    return buffer_.size();
+}
+
+QueryArena::Scope::Scope(QueryArena& arena)
+    : arena_(arena) {
+    ++arena_.depth_;
+}
+
+QueryArena::Scope::~Scope() {
+    if (--arena_.depth_ == 0) {
+        arena_.Reset();
+    }
+}
+
+std::pmr::memory_resource* QueryArena::Scope::Resource() const {
+    return arena_.Resource();
+}
+
+void* QueryArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    overflow_bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool QueryArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+QueryArena& ThreadLocalQueryArena() {
+    thread_local QueryArena arena;
+    return arena;
+}
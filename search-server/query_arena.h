@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// Scratch memory for a single query: parsed words, score accumulators and candidate lists.
+// Allocations come from a monotonic buffer that is rewound after the query, so in steady
+// state a query does not touch the global heap at all.
+class QueryArena {
+public:
+    inline static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+    inline static constexpr size_t DEFAULT_MAX_BUFFER_SIZE = 16 * 1024 * 1024;
+
+    // The buffer never grows past max_buffer_size (or buffer_size, if that is larger): one huge
+    // query doesn't pin its memory on the thread, the overflow of such queries goes to the heap
+    explicit QueryArena(size_t buffer_size = DEFAULT_BUFFER_SIZE, size_t max_buffer_size = DEFAULT_MAX_BUFFER_SIZE);
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* Resource();
+
+    // Frees everything allocated since the last reset. If the buffer overflowed,
+    // it is grown so that the next query of the same size fits into it, up to the maximum size.
+    void Reset();
+
+    size_t GetBufferSize() const;
+
+    // Marks the arena as used by a query; the outermost scope resets it on exit,
+    // so nested queries (e.g. from a predicate) do not free the memory of the outer one.
+    class Scope {
+    public:
+        explicit Scope(QueryArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* Resource() const;
+
+    private:
+        QueryArena& arena_;
+    };
+
+private:
+    // Upstream of the monotonic buffer, counts bytes that did not fit into it
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t overflow_bytes = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::vector<std::byte> buffer_;
+    size_t max_buffer_size_;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    int depth_ = 0;
+};
+
+// Arena of the calling thread, used by queries that don't bring their own
+QueryArena& ThreadLocalQueryArena();
@@ -0,0 +1,19 @@
+#include "query_context.h"
+
+ParsedQuery::ParsedQuery(std::pmr::memory_resource* resource)
+    : plus_words(resource)
+    , minus_words(resource) {
+}
+
+void ParsedQuery::Clear() {
+    plus_words.clear();
+    minus_words.clear();
+}
+
+QueryContext::QueryContext(size_t arena_size)
+    : arena_(arena_size) {
+}
+
+const std::vector<Document>& QueryContext::GetResults() const {
+    return results_;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "query_arena.h"
+
+template <typename Frequency>
+class BasicSearchServer;
+
+// Query words split into plus and minus words, each sorted and deduplicated.
+// Words point into the raw query text, so a parsed query must not outlive it.
+struct ParsedQuery {
+    explicit ParsedQuery(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void Clear();
+
+    std::pmr::vector<std::string_view> plus_words;
+    std::pmr::vector<std::string_view> minus_words;
+};
+
+// Buffers that SearchServer::FindTopDocuments(context, ...) reuses between calls:
+// parsed words, scratch arena and the result vector. Scores go to the thread's ScoreAccumulator.
+// Keep one context per thread; once the buffers have grown, queries do no heap allocations.
+class QueryContext {
+public:
+    explicit QueryContext(size_t arena_size = QueryArena::DEFAULT_BUFFER_SIZE);
+
+    QueryContext(const QueryContext&) = delete;
+    QueryContext& operator=(const QueryContext&) = delete;
+
+    // Results of the last query, valid until the next one
+    const std::vector<Document>& GetResults() const;
+
+private:
+    template <typename Frequency>
+    friend class BasicSearchServer;
+
+    ParsedQuery query_;
+    QueryArena arena_;
+    std::vector<Document> results_;
+};
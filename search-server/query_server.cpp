@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "query_server.h"
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+inline constexpr size_t READ_CHUNK_SIZE = 16 * 1024;
+inline constexpr int MAX_EPOLL_EVENTS = 256;
+
+inline constexpr std::string_view STATUS_NAMES[] = { "ACTUAL"sv, "IRRELEVANT"sv, "BANNED"sv, "REMOVED"sv };
+
+[[noreturn]] void ThrowSystemError(const std::string& action) {
+    throw SocketError(action + ": "s + std::strerror(errno));
+}
+
+std::string_view TakeToken(std::string_view& line) {
+    const size_t space = line.find(' ');
+    const std::string_view token = line.substr(0, space);
+    line.remove_prefix(space == std::string_view::npos ? line.size() : space + 1);
+    return token;
+}
+
+int ParseInt(std::string_view text) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid number "s + std::string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(std::string_view text) {
+    for (size_t status = 0; status < std::size(STATUS_NAMES); ++status) {
+        if (STATUS_NAMES[status] == text) {
+            return static_cast<DocumentStatus>(status);
+        }
+    }
+    throw std::invalid_argument("Invalid document status "s + std::string(text));
+}
+
+std::vector<int> ParseRatings(std::string_view text) {
+    std::vector<int> ratings;
+    if (text == "-"sv) {
+        return ratings;
+    }
+    while (true) {
+        const size_t comma = text.find(',');
+        ratings.push_back(ParseInt(text.substr(0, comma)));
+        if (comma == std::string_view::npos) {
+            return ratings;
+        }
+        text.remove_prefix(comma + 1);
+    }
+}
+
+void AppendNumber(std::string& output, double value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, result.ptr);
+}
+
+void AddToEpoll(const Socket& epoll, int fd, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll.Get(), EPOLL_CTL_ADD, fd, &event) < 0) {
+        ThrowSystemError("epoll_ctl"s);
+    }
+}
+
+}  // namespace
+
+QueryServer::QueryServer(SearchServer& search_server, const Endpoint& endpoint, QueryServerOptions options)
+    : search_server_(search_server)
+    , options_(options)
+    , endpoint_(endpoint)
+    , pool_(options.thread_count) {
+    if (options_.max_batch_size == 0 || options_.max_connection_batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive"s);
+    }
+    listener_ = Listen(endpoint_);
+    SetNonBlocking(listener_);
+    int stop_pipe[2];
+    if (pipe(stop_pipe) < 0) {
+        ThrowSystemError("pipe"s);
+    }
+    stop_reader_ = Socket(stop_pipe[0]);
+    stop_writer_ = Socket(stop_pipe[1]);
+    epoll_ = Socket(epoll_create1(0));
+    if (!epoll_.IsOpen()) {
+        ThrowSystemError("epoll_create1"s);
+    }
+    AddToEpoll(epoll_, listener_.Get(), EPOLLIN);
+    AddToEpoll(epoll_, stop_reader_.Get(), EPOLLIN);
+}
+
+QueryServer::~QueryServer() {
+    if (!endpoint_.unix_path.empty()) {
+        unlink(endpoint_.unix_path.c_str());
+    }
+}
+
+const Endpoint& QueryServer::GetEndpoint() const {
+    return endpoint_;
+}
+
+void QueryServer::Serve() {
+    epoll_event events[MAX_EPOLL_EVENTS];
+    while (!stopping_) {
+        const int ready = epoll_wait(epoll_.Get(), events, MAX_EPOLL_EVENTS, has_pending_input_ ? 0 : -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+        for (int i = 0; i < ready; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listener_.Get()) {
+                AcceptConnections();
+                continue;
+            }
+            const auto connection = connections_.find(fd);
+            if (connection == connections_.end()) {
+                continue;
+            }
+            Connection& client = *connection->second;
+            // A hang-up may come with the last requests still unread: they are read and answered,
+            // and ReadInput marks the input closed at the end of the stream or the connection
+            // closed on a socket error
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                ReadInput(client);
+            }
+            if (events[i].events & EPOLLOUT) {
+                WriteOutput(client);
+            }
+        }
+
+        std::vector<Request> batch = CollectBatch();
+        ExecuteBatch(batch);
+        for (Request& request : batch) {
+            request.connection->output += request.response;
+            request.connection->output += '\n';
+        }
+
+        for (auto connection = connections_.begin(); connection != connections_.end();) {
+            Connection& client = *connection->second;
+            if (client.input_offset > 0) {
+                client.input.erase(0, client.input_offset);
+                client.input_offset = 0;
+            }
+            if (!client.closed && client.output_offset < client.output.size()) {
+                WriteOutput(client);
+            }
+            if (client.input_closed && client.output.empty() && client.input.find('\n') == std::string::npos) {
+                client.closed = true;
+            }
+            if (client.closed) {
+                CloseConnection(client);
+                connection = connections_.erase(connection);
+                continue;
+            }
+            UpdateInterest(client);
+            ++connection;
+        }
+    }
+}
+
+void QueryServer::Stop() {
+    if (!stopping_.exchange(true)) {
+        const char byte = 0;
+        [[maybe_unused]] const ssize_t written = write(stop_writer_.Get(), &byte, 1);
+    }
+}
+
+void QueryServer::AcceptConnections() {
+    while (true) {
+        auto connection = std::make_unique<Connection>();
+        try {
+            connection->socket = Accept(listener_);
+        }
+        catch (const SocketError&) {
+            // EAGAIN: no more pending connections
+            return;
+        }
+        SetNonBlocking(connection->socket);
+        connection->events = EPOLLIN;
+        AddToEpoll(epoll_, connection->socket.Get(), connection->events);
+        const int fd = connection->socket.Get();
+        connections_.emplace(fd, std::move(connection));
+    }
+}
+
+void QueryServer::ReadInput(Connection& connection) {
+    // Reading stops at the line limit even if more is available; the level-triggered
+    // epoll reports the socket again once the buffered lines are answered
+    while (connection.input.size() < options_.max_line_length) {
+        const size_t size = connection.input.size();
+        connection.input.resize(size + READ_CHUNK_SIZE);
+        const ssize_t received = recv(connection.socket.Get(), connection.input.data() + size, READ_CHUNK_SIZE, 0);
+        connection.input.resize(size + static_cast<size_t>(std::max<ssize_t>(received, 0)));
+        if (received > 0) {
+            continue;
+        }
+        if (received == 0) {
+            connection.input_closed = true;
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            connection.closed = true;
+        }
+        return;
+    }
+}
+
+void QueryServer::WriteOutput(Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t sent = send(connection.socket.Get(), connection.output.data() + connection.output_offset,
+            connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                connection.closed = true;
+            }
+            break;
+        }
+        connection.output_offset += static_cast<size_t>(sent);
+    }
+    if (connection.output_offset == connection.output.size()) {
+        connection.output.clear();
+        connection.output_offset = 0;
+    }
+}
+
+std::vector<QueryServer::Request> QueryServer::CollectBatch() {
+    std::vector<Request> batch;
+    has_pending_input_ = false;
+    for (auto& [fd, connection] : connections_) {
+        // Backpressure: a client that doesn't read its answers gets no new ones
+        if (connection->closed || connection->output.size() - connection->output_offset >= options_.max_output_size) {
+            continue;
+        }
+        const std::string_view input = connection->input;
+        for (size_t taken = 0; ; ++taken) {
+            const size_t line_end = input.find('\n', connection->input_offset);
+            if (line_end == std::string_view::npos) {
+                if (input.size() - connection->input_offset >= options_.max_line_length) {
+                    connection->closed = true;
+                }
+                break;
+            }
+            if (taken == options_.max_connection_batch_size || batch.size() == options_.max_batch_size) {
+                has_pending_input_ = true;
+                break;
+            }
+            std::string_view line = input.substr(connection->input_offset, line_end - connection->input_offset);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            batch.push_back({ connection.get(), line, {} });
+            connection->input_offset = line_end + 1;
+        }
+    }
+    return batch;
+}
+
+void QueryServer::ExecuteBatch(std::vector<Request>& batch) {
+    // Queries between two updates run in parallel; updates run alone, in order
+    size_t begin = 0;
+    while (begin < batch.size()) {
+        size_t end = begin;
+        while (end < batch.size() && batch[end].line.substr(0, 4) != "ADD "sv) {
+            ++end;
+        }
+        pool_.ParallelFor(end - begin, [this, &batch, begin](size_t index) {
+            Request& request = batch[begin + index];
+            request.response = ExecuteRequest(request.line);
+            });
+        if (end < batch.size()) {
+            batch[end].response = ExecuteRequest(batch[end].line);
+            ++end;
+        }
+        begin = end;
+    }
+}
+
+std::string QueryServer::ExecuteRequest(std::string_view line) {
+    try {
+        const std::string_view command = TakeToken(line);
+        std::string response = "OK"s;
+        if (command == "FIND"sv) {
+            for (const Document& document : search_server_.FindTopDocuments(std::string(line))) {
+                response += ' ';
+                response += std::to_string(document.id);
+                response += ':';
+                AppendNumber(response, document.relevance);
+                response += ':';
+                response += std::to_string(document.rating);
+            }
+        }
+        else if (command == "MATCH"sv) {
+            const int document_id = ParseInt(TakeToken(line));
+            const auto [words, status] = search_server_.MatchDocument(std::string(line), document_id);
+            response += ' ';
+            response += STATUS_NAMES[static_cast<size_t>(status)];
+            for (const std::string& word : words) {
+                response += ' ';
+                response += word;
+            }
+        }
+        else if (command == "ADD"sv) {
+            const int document_id = ParseInt(TakeToken(line));
+            const DocumentStatus status = ParseStatus(TakeToken(line));
+            const std::vector<int> ratings = ParseRatings(TakeToken(line));
+            search_server_.AddDocument(document_id, std::string(line), status, ratings);
+        }
+        else {
+            throw std::invalid_argument("Unknown command "s + std::string(command));
+        }
+        return response;
+    }
+    catch (const std::exception& error) {
+        return "ERR "s + error.what();
+    }
+}
+
+void QueryServer::UpdateInterest(Connection& connection) {
+    const size_t pending_output = connection.output.size() - connection.output_offset;
+    uint32_t events = 0;
+    if (!connection.input_closed && pending_output < options_.max_output_size
+        && connection.input.size() < options_.max_line_length) {
+        events |= EPOLLIN;
+    }
+    if (pending_output > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = connection.socket.Get();
+    epoll_ctl(epoll_.Get(), EPOLL_CTL_MOD, connection.socket.Get(), &event);
+    connection.events = events;
+}
+
+void QueryServer::CloseConnection(Connection& connection) {
+    epoll_ctl(epoll_.Get(), EPOLL_CTL_DEL, connection.socket.Get(), nullptr);
+    connection.socket.Close();
+}
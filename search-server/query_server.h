@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+#include "socket_io.h"
+#include "thread_pool.h"
+
+// Requests and responses are single lines ending with '\n':
+//     FIND <query>                              -> OK <id>:<relevance>:<rating> ...
+//     MATCH <document_id> <query>               -> OK <status> <word> ...
+//     ADD <document_id> <status> <ratings> <text> -> OK
+// where <status> is ACTUAL, IRRELEVANT, BANNED or REMOVED and <ratings> is a comma separated
+// list, or '-' for none. Failed requests get "ERR <message>". Clients may send many requests
+// without waiting; responses come back in the same order.
+
+struct QueryServerOptions {
+    size_t thread_count = 0;
+    // Requests taken from all connections for one round of parallel evaluation
+    size_t max_batch_size = 1024;
+    // Requests taken from one connection per round, so one client can't fill the whole batch
+    size_t max_connection_batch_size = 64;
+    // A connection is not read while this many response bytes are waiting to be sent
+    size_t max_output_size = 1024 * 1024;
+    size_t max_line_length = 64 * 1024;
+};
+
+// Single-threaded epoll event loop (Linux only); queries collected in one round are evaluated
+// in parallel on a ThreadPool. Updates are applied between queries in batch order.
+class QueryServer {
+public:
+    // Starts listening immediately; a TCP endpoint with port 0 gets a free port, see GetEndpoint
+    QueryServer(SearchServer& search_server, const Endpoint& endpoint, QueryServerOptions options = {});
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    ~QueryServer();
+
+    const Endpoint& GetEndpoint() const;
+
+    // Runs the event loop until Stop() is called
+    void Serve();
+
+    // Safe to call from another thread or a signal handler
+    void Stop();
+
+private:
+    struct Connection {
+        Socket socket;
+        std::string input;
+        // Bytes of input taken by the current batch
+        size_t input_offset = 0;
+        std::string output;
+        size_t output_offset = 0;
+        // Currently registered epoll events
+        uint32_t events = 0;
+        // The client shut down its side; the connection closes once all answers are sent
+        bool input_closed = false;
+        bool closed = false;
+    };
+
+    struct Request {
+        Connection* connection;
+        std::string_view line;
+        std::string response;
+    };
+
+    SearchServer& search_server_;
+    QueryServerOptions options_;
+    Endpoint endpoint_;
+    Socket listener_;
+    Socket epoll_;
+    Socket stop_reader_;
+    Socket stop_writer_;
+    std::atomic<bool> stopping_ = false;
+    std::map<int, std::unique_ptr<Connection>> connections_;
+    // Some complete lines were left for the next round, so the loop must not block
+    bool has_pending_input_ = false;
+    ThreadPool pool_;
+
+    void AcceptConnections();
+
+    void ReadInput(Connection& connection);
+
+    void WriteOutput(Connection& connection);
+
+    // Takes complete lines from connections' input buffers, at most max_batch_size in total
+    std::vector<Request> CollectBatch();
+
+    void ExecuteBatch(std::vector<Request>& batch);
+
+    std::string ExecuteRequest(std::string_view line);
+
+    // Switches EPOLLIN/EPOLLOUT interest to match the connection's buffers
+    void UpdateInterest(Connection& connection);
+
+    void CloseConnection(Connection& connection);
+};
@@ -4,10 +4,10 @@ void RemoveDuplicates(SearchServer& search_server) {
     std::map<std::set<std::string>, int> words_to_id;
     std::set<int> duplicate_ids;
     for (const int document_id : search_server) {
-        std::map<std::string, double> word_to_id_freqs = search_server.GetWordFrequencies(document_id);
+        const auto& word_to_id_freqs = search_server.GetIndexedWordFrequencies(document_id);
         std::set<std::string> words;
         for (const auto& [word, freq] : word_to_id_freqs) {
-            words.emplace(word);
+            words.emplace(word.begin(), word.end());
         }
         if (words_to_id.count(words)) {
             duplicate_ids.emplace(document_id);
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "score_accumulator.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// Accumulators of the thread; the first depth of them are taken by running queries
+template <typename Accumulator>
+struct AccumulatorStack {
+    std::vector<std::unique_ptr<Accumulator>> accumulators;
+    size_t depth = 0;
+
+    Accumulator* Take() {
+        if (depth == accumulators.size()) {
+            accumulators.push_back(std::make_unique<Accumulator>());
+        }
+        return accumulators[depth++].get();
+    }
+};
+
+template <typename Accumulator>
+AccumulatorStack<Accumulator>& ThreadAccumulators() {
+    thread_local AccumulatorStack<Accumulator> stack;
+    return stack;
+}
+
+// Advances the epoch; when the stamps wrap around, old ones could look current again
+void NextEpoch(uint32_t& epoch, std::vector<uint32_t>& epochs) {
+    if (++epoch == 0) {
+        std::fill(epochs.begin(), epochs.end(), 0);
+        epoch = 1;
+    }
+}
+
+}  // namespace
+
+template <typename RelevanceSum>
+void ScoreAccumulator<RelevanceSum>::Reset(size_t ordinal_count) {
+    touched_.clear();
+    NextEpoch(epoch_, epochs_);
+    if (scores_.size() < ordinal_count) {
+        scores_.resize(ordinal_count);
+        epochs_.resize(ordinal_count, 0);
+    }
+}
+
+template <typename RelevanceSum>
+void BatchScoreAccumulator<RelevanceSum>::Reset(size_t ordinal_count, size_t query_count) {
+    if (query_count > MAX_QUERY_COUNT) {
+        throw std::invalid_argument("Too many queries in a batch: "s + std::to_string(query_count));
+    }
+    touched_.clear();
+    NextEpoch(epoch_, epochs_);
+    query_count_ = query_count;
+    if (epochs_.size() < ordinal_count) {
+        epochs_.resize(ordinal_count, 0);
+        query_masks_.resize(ordinal_count);
+    }
+    // Slots are re-strided when the query count changes; their contents are never read before a write
+    if (scores_.size() < ordinal_count * query_count) {
+        scores_.resize(ordinal_count * query_count);
+    }
+}
+
+template <typename RelevanceSum>
+ThreadLocalScoreAccumulator<RelevanceSum>::ThreadLocalScoreAccumulator(size_t ordinal_count)
+    : accumulator_(ThreadAccumulators<ScoreAccumulator<RelevanceSum>>().Take()) {
+    accumulator_->Reset(ordinal_count);
+}
+
+template <typename RelevanceSum>
+ThreadLocalScoreAccumulator<RelevanceSum>::~ThreadLocalScoreAccumulator() {
+    --ThreadAccumulators<ScoreAccumulator<RelevanceSum>>().depth;
+}
+
+template <typename RelevanceSum>
+ThreadLocalBatchScoreAccumulator<RelevanceSum>::ThreadLocalBatchScoreAccumulator(size_t ordinal_count, size_t query_count)
+    : accumulator_(ThreadAccumulators<BatchScoreAccumulator<RelevanceSum>>().Take()) {
+    accumulator_->Reset(ordinal_count, query_count);
+}
+
+template <typename RelevanceSum>
+ThreadLocalBatchScoreAccumulator<RelevanceSum>::~ThreadLocalBatchScoreAccumulator() {
+    --ThreadAccumulators<BatchScoreAccumulator<RelevanceSum>>().depth;
+}
+
+// Relevance types of the index
+template class ScoreAccumulator<float>;
+template class ScoreAccumulator<double>;
+template class BatchScoreAccumulator<float>;
+template class BatchScoreAccumulator<double>;
+template class ThreadLocalScoreAccumulator<float>;
+template class ThreadLocalScoreAccumulator<double>;
+template class ThreadLocalBatchScoreAccumulator<float>;
+template class ThreadLocalBatchScoreAccumulator<double>;
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Dense relevance accumulator for term-at-a-time evaluation: one slot per document ordinal.
+// A slot belongs to the current query only if its stamp equals the current epoch, so a new
+// query starts in O(1) instead of clearing the array; the reached ordinals are listed separately.
+// RelevanceSum is the type the index sums relevance in (float or double).
+template <typename RelevanceSum>
+class ScoreAccumulator {
+public:
+    // Starts a new query over ordinals [0, ordinal_count)
+    void Reset(size_t ordinal_count);
+
+    void Add(int ordinal, RelevanceSum relevance) {
+        if (epochs_[ordinal] != epoch_) {
+            epochs_[ordinal] = epoch_;
+            scores_[ordinal] = relevance;
+            touched_.push_back(ordinal);
+        }
+        else {
+            scores_[ordinal] += relevance;
+        }
+    }
+
+    RelevanceSum Get(int ordinal) const {
+        return scores_[ordinal];
+    }
+
+    // Ordinals that got a score in the current query, in the order they were reached
+    const std::vector<int>& GetTouched() const {
+        return touched_;
+    }
+
+private:
+    std::vector<RelevanceSum> scores_;
+    std::vector<uint32_t> epochs_;
+    std::vector<int> touched_;
+    uint32_t epoch_ = 0;
+};
+
+// Scores of several queries evaluated together. The slots of one ordinal are adjacent, so a posting
+// shared by all the queries updates one or two cache lines instead of one line per query.
+// Epochs and the touched list work as in ScoreAccumulator; a per-ordinal mask tells which
+// queries reached the document, since a zero score (a word in every document) is still a match.
+template <typename RelevanceSum>
+class BatchScoreAccumulator {
+public:
+    // Eight double scores of an ordinal fill one cache line
+    inline static constexpr size_t MAX_QUERY_COUNT = 8;
+
+    // Starts a new batch of query_count queries over ordinals [0, ordinal_count)
+    void Reset(size_t ordinal_count, size_t query_count);
+
+    void Add(int ordinal, size_t query_index, RelevanceSum relevance) {
+        RelevanceSum* scores = &scores_[static_cast<size_t>(ordinal) * query_count_];
+        if (epochs_[ordinal] != epoch_) {
+            epochs_[ordinal] = epoch_;
+            query_masks_[ordinal] = 0;
+            touched_.push_back(ordinal);
+        }
+        const uint8_t query_bit = static_cast<uint8_t>(1u << query_index);
+        if (query_masks_[ordinal] & query_bit) {
+            scores[query_index] += relevance;
+        }
+        else {
+            query_masks_[ordinal] |= query_bit;
+            scores[query_index] = relevance;
+        }
+    }
+
+    bool Has(int ordinal, size_t query_index) const {
+        return query_masks_[ordinal] >> query_index & 1u;
+    }
+
+    RelevanceSum Get(int ordinal, size_t query_index) const {
+        return scores_[static_cast<size_t>(ordinal) * query_count_ + query_index];
+    }
+
+    // Ordinals reached by any query of the batch
+    const std::vector<int>& GetTouched() const {
+        return touched_;
+    }
+
+private:
+    std::vector<RelevanceSum> scores_;
+    std::vector<uint32_t> epochs_;
+    std::vector<uint8_t> query_masks_;
+    std::vector<int> touched_;
+    size_t query_count_ = 0;
+    uint32_t epoch_ = 0;
+};
+
+// Accumulator of the calling thread for one query, reset for ordinal_count ordinals.
+// A nested query on the same thread (e.g. from a predicate) gets another one, so it doesn't
+// clobber the scores of the outer query. Once grown, queries reuse the arrays without allocating.
+template <typename RelevanceSum>
+class ThreadLocalScoreAccumulator {
+public:
+    explicit ThreadLocalScoreAccumulator(size_t ordinal_count);
+    ~ThreadLocalScoreAccumulator();
+
+    ThreadLocalScoreAccumulator(const ThreadLocalScoreAccumulator&) = delete;
+    ThreadLocalScoreAccumulator& operator=(const ThreadLocalScoreAccumulator&) = delete;
+
+    ScoreAccumulator<RelevanceSum>& operator*() const {
+        return *accumulator_;
+    }
+
+    ScoreAccumulator<RelevanceSum>* operator->() const {
+        return accumulator_;
+    }
+
+private:
+    ScoreAccumulator<RelevanceSum>* accumulator_;
+};
+
+// Same for a batch of at most BatchScoreAccumulator::MAX_QUERY_COUNT queries
+template <typename RelevanceSum>
+class ThreadLocalBatchScoreAccumulator {
+public:
+    ThreadLocalBatchScoreAccumulator(size_t ordinal_count, size_t query_count);
+    ~ThreadLocalBatchScoreAccumulator();
+
+    ThreadLocalBatchScoreAccumulator(const ThreadLocalBatchScoreAccumulator&) = delete;
+    ThreadLocalBatchScoreAccumulator& operator=(const ThreadLocalBatchScoreAccumulator&) = delete;
+
+    BatchScoreAccumulator<RelevanceSum>& operator*() const {
+        return *accumulator_;
+    }
+
+    BatchScoreAccumulator<RelevanceSum>* operator->() const {
+        return accumulator_;
+    }
+
+private:
+    BatchScoreAccumulator<RelevanceSum>* accumulator_;
+};
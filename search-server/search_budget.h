@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "document.h"
+
+using SearchClock = std::chrono::steady_clock;
+
+// Limits of one query's traversal; it stops at whichever is reached first
+struct SearchBudget {
+    SearchClock::time_point deadline = SearchClock::time_point::max();
+    size_t max_postings = std::numeric_limits<size_t>::max();
+};
+
+struct BudgetedResult {
+    std::vector<Document> documents;
+    // The budget ran out before all postings were visited; documents are the best of what was scored
+    bool is_partial = false;
+    size_t visited_postings = 0;
+};
@@ -0,0 +1,40 @@
+#include <algorithm>
+
+#include "search_cursor.h"
+#include "search_server.h"
+
+namespace {
+
+bool IsRankedAfter(const Document& lhs, const Document& rhs) {
+    return SearchServer::IsRankedBefore(rhs, lhs);
+}
+
+}  // namespace
+
+ResultPager::ResultPager(std::vector<Document> documents)
+    : heap_(std::move(documents)) {
+    std::make_heap(heap_.begin(), heap_.end(), IsRankedAfter);
+}
+
+ResultPage ResultPager::NextPage(size_t page_size) {
+    ResultPage page;
+    page.documents.reserve(std::min(page_size, heap_.size()));
+    while (page.documents.size() < page_size && !heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsRankedAfter);
+        page.documents.push_back(heap_.back());
+        heap_.pop_back();
+    }
+    if (!heap_.empty() && !page.documents.empty()) {
+        const Document& last = page.documents.back();
+        page.next = SearchCursor{ last.relevance, last.rating, last.id };
+    }
+    return page;
+}
+
+bool ResultPager::HasNextPage() const {
+    return !heap_.empty();
+}
+
+size_t ResultPager::GetRemainingCount() const {
+    return heap_.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+// Ranking position of the last document of a page; the next page starts right after it
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int id = 0;
+};
+
+struct ResultPage {
+    std::vector<Document> documents;
+    // Empty when this is the last page
+    std::optional<SearchCursor> next;
+};
+
+// Matched documents of one query kept in a heap, so a page costs O(page_size * log(count))
+// and pages nobody asks for are never sorted
+class ResultPager {
+public:
+    explicit ResultPager(std::vector<Document> documents);
+
+    ResultPage NextPage(size_t page_size);
+
+    bool HasNextPage() const;
+
+    size_t GetRemainingCount() const;
+
+private:
+    std::vector<Document> heap_;
+};
@@ -3,115 +3,471 @@
 #include <stdexcept>
 
 #include "search_server.h"
+#include "shard_protocol.h"
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor from string container
+template <typename Frequency>
+BasicSearchServer<Frequency>::BasicSearchServer(const std::string& stop_words_text)
+    : BasicSearchServer(SplitIntoWords(stop_words_text))  // Invoke delegating constructor from string container
 {
 }
 
-SearchServer::SearchServer() = default;
+template <typename Frequency>
+BasicSearchServer<Frequency>::BasicSearchServer() = default;
 
-void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
+template <typename Frequency>
+void BasicSearchServer<Frequency>::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
 
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || (document_ordinals_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id"s);
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+    const auto words = SplitIntoWordsNoStop(document, scratch.Resource());
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        std::pmr::vector<std::string_view> word_set(words, scratch.Resource());
+        std::sort(word_set.begin(), word_set.end());
+        word_set.erase(std::unique(word_set.begin(), word_set.end()), word_set.end());
+        if (!AdmitDocument(document_id, word_set)) {
+            return;
+        }
+    }
+    ++generation_;
+
+    const int ordinal = static_cast<int>(documents_.size());
+    documents_.push_back({ document_id, ComputeAverageRating(ratings), status });
+    document_ordinals_.emplace(document_id, ordinal);
+    status_bitmaps_[static_cast<size_t>(status)].Set(ordinal);
 
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        id_to_word_freqs_[document_id][word] += inv_word_count;
+    auto& document_freqs = id_to_word_freqs_[document_id];
+    // Term frequencies are final only after all the words are counted
+    std::pmr::vector<const Postings*> word_postings(scratch.Resource());
+    for (const std::string_view word : words) {
+        auto postings = word_to_document_freqs_.lower_bound(word);
+        if (postings == word_to_document_freqs_.end() || postings->first != word) {
+            postings = word_to_document_freqs_.emplace_hint(postings, std::piecewise_construct,
+                std::forward_as_tuple(word), std::forward_as_tuple(&postings_memory_));
+            AddToPrefixIndex(postings->first);
+        }
+        postings->second[ordinal] += inv_word_count;
+
+        auto word_freq = document_freqs.lower_bound(word);
+        if (word_freq == document_freqs.end() || word_freq->first != word) {
+            word_freq = document_freqs.emplace_hint(word_freq, word, 0.0);
+            ++posting_count_;
+            if (impact_order_min_postings_ > 0) {
+                word_postings.push_back(&postings->second);
+            }
+        }
+        word_freq->second += inv_word_count;
+    }
+    if (impact_order_min_postings_ > 0) {
+        AddToImpactOrders(ordinal, word_postings);
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
     document_ids_.emplace(document_id);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
-    return FindTopDocuments(
-        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        });
+template <typename Frequency>
+std::vector<Document> BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, StatusEquals{ status });
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query) const {
+template <typename Frequency>
+std::vector<Document> BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(documents_.size());
+template <typename Frequency>
+BudgetedResult BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query, DocumentStatus status,
+    const SearchBudget& budget) const {
+    return FindTopDocuments(raw_query, StatusEquals{ status }, budget);
+}
+
+template <typename Frequency>
+BudgetedResult BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query, const SearchBudget& budget) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, budget);
+}
+
+template <typename Frequency>
+const std::vector<Document>& BasicSearchServer<Frequency>::FindTopDocuments(QueryContext& context, const std::string& raw_query,
+    DocumentStatus status) const {
+    return FindTopDocuments(context, raw_query, StatusEquals{ status });
+}
+
+template <typename Frequency>
+const std::vector<Document>& BasicSearchServer<Frequency>::FindTopDocuments(QueryContext& context, const std::string& raw_query) const {
+    return FindTopDocuments(context, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Frequency>
+std::vector<std::vector<Document>> BasicSearchServer<Frequency>::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+    DocumentStatus status) const {
+    return FindTopDocumentsBatch(raw_queries, StatusEquals{ status });
+}
+
+template <typename Frequency>
+std::vector<std::vector<Document>> BasicSearchServer<Frequency>::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const {
+    return FindTopDocumentsBatch(raw_queries, DocumentStatus::ACTUAL);
+}
+
+template <typename Frequency>
+std::future<std::vector<Document>> BasicSearchServer<Frequency>::FindTopDocumentsAsync(ThreadPool& pool, const std::string& raw_query,
+    DocumentStatus status) const {
+    return FindTopDocumentsAsync(pool, raw_query, StatusEquals{ status });
+}
+
+template <typename Frequency>
+std::future<std::vector<Document>> BasicSearchServer<Frequency>::FindTopDocumentsAsync(ThreadPool& pool, const std::string& raw_query) const {
+    return FindTopDocumentsAsync(pool, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Frequency>
+ResultPage BasicSearchServer<Frequency>::FindTopDocumentsAfter(const std::string& raw_query, DocumentStatus status,
+    const std::optional<SearchCursor>& after, size_t page_size) const {
+    return FindTopDocumentsAfter(raw_query, StatusEquals{ status }, after, page_size);
+}
+
+template <typename Frequency>
+ResultPage BasicSearchServer<Frequency>::FindTopDocumentsAfter(const std::string& raw_query, const std::optional<SearchCursor>& after,
+    size_t page_size) const {
+    return FindTopDocumentsAfter(raw_query, DocumentStatus::ACTUAL, after, page_size);
+}
+
+template <typename Frequency>
+ResultPager BasicSearchServer<Frequency>::FindDocumentPages(const std::string& raw_query, DocumentStatus status) const {
+    return FindDocumentPages(raw_query, StatusEquals{ status });
+}
+
+template <typename Frequency>
+ResultPager BasicSearchServer<Frequency>::FindDocumentPages(const std::string& raw_query) const {
+    return FindDocumentPages(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::SetMaxPrefixExpansions(size_t max_expansions) {
+    max_prefix_expansions_ = max_expansions;
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::SetDuplicatePolicy(DuplicatePolicy policy) {
+    if (policy == DuplicatePolicy::ALLOW) {
+        word_set_index_.clear();
+    }
+    else if (duplicate_policy_ == DuplicatePolicy::ALLOW) {
+        QueryArena::Scope scratch(ThreadLocalQueryArena());
+        std::pmr::vector<std::string_view> words(scratch.Resource());
+        for (const auto& [document_id, word_freqs] : id_to_word_freqs_) {
+            words.clear();
+            for (const auto& [word, _] : word_freqs) {
+                words.push_back(word);
+            }
+            word_set_index_.emplace(ComputeWordSetFingerprint(words), document_id);
+        }
+    }
+    duplicate_policy_ = policy;
+}
+
+template <typename Frequency>
+const std::pmr::map<int, int>& BasicSearchServer<Frequency>::GetDuplicates() const {
+    return duplicates_;
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::SetImpactOrderThreshold(size_t min_postings) {
+    impact_order_min_postings_ = min_postings;
+    // Unlike clear(), frees the buckets too
+    decltype(impact_orders_)(&impact_order_memory_).swap(impact_orders_);
+    if (min_postings == 0) {
+        return;
+    }
+    for (const auto& [word, postings] : word_to_document_freqs_) {
+        if (postings.size() >= min_postings) {
+            SortImpactOrder(impact_orders_.emplace(std::piecewise_construct, std::forward_as_tuple(&postings),
+                std::forward_as_tuple(&impact_order_memory_)).first->second, postings);
+        }
+    }
+}
+
+template <typename Frequency>
+IndexMemoryStats BasicSearchServer<Frequency>::GetMemoryStats() const {
+    IndexMemoryStats stats;
+    stats.dictionary_bytes = dictionary_memory_.GetAllocatedBytes();
+    stats.postings_bytes = postings_memory_.GetAllocatedBytes();
+    stats.forward_index_bytes = forward_index_memory_.GetAllocatedBytes();
+    stats.metadata_bytes = metadata_memory_.GetAllocatedBytes();
+    stats.impact_order_bytes = impact_order_memory_.GetAllocatedBytes();
+    {
+        std::shared_lock lock(prefix_index_mutex_);
+        if (prefix_index_) {
+            stats.cache_bytes = sizeof(PrefixIndex) + prefix_index_->terms.GetMemoryUsage()
+                + prefix_index_->added_words.size() * sizeof(std::string_view);
+            for (const std::string& word : prefix_index_->removed_words) {
+                stats.cache_bytes += sizeof(word) + word.capacity();
+            }
+        }
+    }
+    {
+        std::lock_guard guard(minus_word_cache_mutex_);
+        for (const auto& [word, cached] : minus_word_cache_) {
+            stats.cache_bytes += word.capacity() + sizeof(DocumentBitmap) + cached.documents->GetMemoryUsage();
+        }
+    }
+    const size_t used_bytes = stats.dictionary_bytes + stats.postings_bytes + stats.forward_index_bytes + stats.metadata_bytes
+        + stats.impact_order_bytes;
+    const size_t pool_bytes = system_memory_.GetAllocatedBytes();
+    stats.allocator_overhead_bytes = pool_bytes > used_bytes ? pool_bytes - used_bytes : 0;
+    stats.total_bytes = std::max(pool_bytes, used_bytes) + stats.cache_bytes;
+
+    stats.vocabulary_size = word_to_document_freqs_.size();
+    stats.document_count = document_ordinals_.size();
+    stats.posting_count = posting_count_;
+    if (stats.vocabulary_size > 0) {
+        stats.average_posting_length = static_cast<double>(posting_count_) / stats.vocabulary_size;
+    }
+    return stats;
+}
+
+template <typename Frequency>
+int BasicSearchServer<Frequency>::GetDocumentCount() const {
+    return static_cast<int>(document_ordinals_.size());
 }
 
-std::set<int>::const_iterator SearchServer::begin() const { 
+template <typename Frequency>
+bool BasicSearchServer<Frequency>::HasDocument(int document_id) const {
+    return document_ordinals_.count(document_id) > 0;
+}
+
+template <typename Frequency>
+TermStatistics BasicSearchServer<Frequency>::GetTermStatistics(const std::string& raw_query) const {
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+    ParsedQuery query(scratch.Resource());
+    ParseQuery(raw_query, query, scratch.Resource());
+
+    TermStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    for (const std::string_view word : query.plus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        statistics.document_freqs.emplace(word,
+            postings == word_to_document_freqs_.end() ? 0 : static_cast<int>(postings->second.size()));
+    }
+    return statistics;
+}
+
+template <typename Frequency>
+std::set<int>::const_iterator BasicSearchServer<Frequency>::begin() const { 
     return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const { 
+template <typename Frequency>
+std::set<int>::const_iterator BasicSearchServer<Frequency>::end() const { 
     return document_ids_.end();
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const {
+template <typename Frequency>
+const std::map<std::string, double>& BasicSearchServer<Frequency>::GetWordFrequencies(int document_id) const {
     const static std::map<std::string, double> empty_map;
-    if (!id_to_word_freqs_.count(document_id)) {
+    const auto document_words = id_to_word_freqs_.find(document_id);
+    if (document_words == id_to_word_freqs_.end()) {
+        return empty_map;
+    }
+    std::lock_guard guard(word_frequencies_copies_mutex_);
+    auto [copy, inserted] = word_frequencies_copies_.try_emplace(document_id);
+    if (inserted) {
+        for (const auto& [word, term_freq] : document_words->second) {
+            copy->second.emplace_hint(copy->second.end(), word, term_freq);
+        }
+    }
+    return copy->second;
+}
+
+template <typename Frequency>
+const typename BasicSearchServer<Frequency>::WordFrequencies& BasicSearchServer<Frequency>::GetIndexedWordFrequencies(int document_id) const {
+    const static WordFrequencies empty_map;
+    const auto document_words = id_to_word_freqs_.find(document_id);
+    if (document_words == id_to_word_freqs_.end()) {
        return empty_map;
     }
-    return id_to_word_freqs_.at(document_id);
+    return document_words->second;
 }
  
-void SearchServer::RemoveDocument(int document_id) {
-    for (auto& [words, freqs] : GetWordFrequencies(document_id)) {
-        if (word_to_document_freqs_.count(words)) {
-            word_to_document_freqs_.erase(words);
+template <typename Frequency>
+void BasicSearchServer<Frequency>::RemoveDocument(int document_id) {
+    const auto document_words = id_to_word_freqs_.find(document_id);
+    if (document_words == id_to_word_freqs_.end()) {
+        return;
+    }
+    ++generation_;
+    const auto ordinal = document_ordinals_.find(document_id);
+    const DocumentStatus status = documents_[ordinal->second].status;
+    // Only this document's postings go away, other documents keep the word
+    for (const auto& [word, _] : document_words->second) {
+        const auto postings = word_to_document_freqs_.find(word);
+        const auto impact_order = impact_orders_.find(&postings->second);
+        if (impact_order != impact_orders_.end()) {
+            RemoveFromImpactOrder(impact_order->second, *postings->second.find(ordinal->second), status);
+        }
+        postings->second.erase(ordinal->second);
+        --posting_count_;
+        if (postings->second.empty()) {
+            if (impact_order != impact_orders_.end()) {
+                impact_orders_.erase(impact_order);
+            }
+            RemoveFromPrefixIndex(postings->first);
+            word_to_document_freqs_.erase(postings);
         }
     }
-    if (documents_.count(document_id)) {
-        documents_.erase(document_id);
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        UnregisterWordSet(document_id, document_words->second);
     }
+    duplicates_.erase(document_id);
+    auto& document_data = documents_[ordinal->second];
+    status_bitmaps_[static_cast<size_t>(status)].Reset(ordinal->second);
+    document_data.id = -1;
+    document_ordinals_.erase(ordinal);
     document_ids_.erase(document_id);
-    id_to_word_freqs_.erase(document_id);
+    id_to_word_freqs_.erase(document_words);
+    {
+        std::lock_guard guard(word_frequencies_copies_mutex_);
+        word_frequencies_copies_.erase(document_id);
+    }
+    // The pass over the index is paid for by the removals since the last one, at least as many as live documents
+    if (document_ordinals_.size() * 2 < documents_.size()) {
+        CompactOrdinals();
+    }
+}
 
+template <typename Frequency>
+void BasicSearchServer<Frequency>::CopyDocumentFrom(const BasicSearchServer& source, int document_id) {
+    if ((document_id < 0) || (document_ordinals_.count(document_id) > 0)) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    AddIndexedDocument(source.documents_[source.document_ordinals_.at(document_id)], source.GetIndexedWordFrequencies(document_id));
 }
 
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string& raw_query, int document_id) const {
-    const auto& query = ParseQuery(raw_query);
+template <typename Frequency>
+void BasicSearchServer<Frequency>::SaveSnapshot(std::ostream& output) const {
+    MessageWriter header;
+    header.WriteUint(SNAPSHOT_MAGIC);
+    header.WriteUint(static_cast<uint32_t>(document_ids_.size()));
+    output.write(header.GetData().data(), header.GetData().size());
+    // One length-prefixed record per document, so the whole index is never buffered at once
+    for (const int document_id : document_ids_) {
+        const DocumentData& data = documents_[document_ordinals_.at(document_id)];
+        const WordFrequencies& word_freqs = id_to_word_freqs_.at(document_id);
+        MessageWriter record;
+        record.WriteInt(data.id);
+        record.WriteInt(data.rating);
+        record.WriteByte(static_cast<uint8_t>(data.status));
+        record.WriteUint(static_cast<uint32_t>(word_freqs.size()));
+        for (const auto& [word, term_freq] : word_freqs) {
+            record.WriteString(word);
+            record.WriteDouble(term_freq);
+        }
+        MessageWriter size;
+        size.WriteUint(static_cast<uint32_t>(record.GetData().size()));
+        output.write(size.GetData().data(), size.GetData().size());
+        output.write(record.GetData().data(), record.GetData().size());
+    }
+    if (!output) {
+        throw std::runtime_error("Cannot write snapshot"s);
+    }
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::LoadSnapshot(std::istream& input) {
+    const auto read = [&input](size_t size) {
+        std::string data(size, '\0');
+        if (!input.read(data.data(), size)) {
+            throw std::runtime_error("Snapshot is truncated"s);
+        }
+        return data;
+    };
+    const std::string header_data = read(8);
+    MessageReader header(header_data);
+    if (header.ReadUint() != SNAPSHOT_MAGIC) {
+        throw std::runtime_error("Not a snapshot"s);
+    }
+    const uint32_t document_count = header.ReadUint();
+    std::string record_data;
+    std::vector<std::pair<std::string_view, double>> word_freqs;
+    for (uint32_t i = 0; i < document_count; ++i) {
+        const std::string size_data = read(4);
+        record_data = read(MessageReader(size_data).ReadUint());
+        MessageReader record(record_data);
+        DocumentData data;
+        data.id = record.ReadInt();
+        data.rating = record.ReadInt();
+        const uint8_t status = record.ReadByte();
+        if (status >= DOCUMENT_STATUS_COUNT) {
+            throw std::runtime_error("Invalid document status in snapshot"s);
+        }
+        data.status = static_cast<DocumentStatus>(status);
+        word_freqs.resize(record.ReadUint());
+        for (auto& [word, term_freq] : word_freqs) {
+            word = record.ReadStringView();
+            term_freq = record.ReadDouble();
+        }
+        AddIndexedDocument(data, word_freqs);
+    }
+}
+
+template <typename Frequency>
+std::tuple<std::vector<std::string>, DocumentStatus> BasicSearchServer<Frequency>::MatchDocument(const std::string& raw_query, int document_id) const {
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+    ParsedQuery query(scratch.Resource());
+    ParseQuery(raw_query, query, scratch.Resource());
+    const int ordinal = document_ordinals_.at(document_id);
 
     std::vector<std::string> matched_words;
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    for (const std::string_view word : query.plus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+        if (postings->second.count(ordinal)) {
             matched_words.emplace_back(word);
         }
     }
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    for (const std::string_view word : query.minus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+        if (postings->second.count(ordinal)) {
             matched_words.clear();
             break;
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, documents_[ordinal].status };
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
+template <typename Frequency>
+std::future<std::tuple<std::vector<std::string>, DocumentStatus>> BasicSearchServer<Frequency>::MatchDocumentAsync(ThreadPool& pool,
+    const std::string& raw_query, int document_id) const {
+    return pool.Submit([this, raw_query, document_id] {
+        return MatchDocument(raw_query, document_id);
+        });
+}
+
+template <typename Frequency>
+bool BasicSearchServer<Frequency>::IsStopWord(std::string_view word) const {
     return stop_words_.count(word) > 0;
 }
 
-bool SearchServer::IsValidWord(const std::string& word) {
+template <typename Frequency>
+bool BasicSearchServer<Frequency>::IsValidWord(std::string_view word) {
     // A valid word must not contain special characters
-    return none_of(word.begin(), word.end(), [](char c) {
+    return std::none_of(word.begin(), word.end(), [](char c) {
         return c >= '\0' && c < ' ';
         });
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
+template <typename Frequency>
+std::pmr::vector<std::string_view> BasicSearchServer<Frequency>::SplitIntoWordsNoStop(std::string_view text,
+    std::pmr::memory_resource* resource) const {
+    std::pmr::vector<std::string_view> words(resource);
+    for (const std::string_view word : SplitIntoWordsView(text, resource)) {
         if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word "s + word + " is invalid"s);
+            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
         }
         if (!IsStopWord(word)) {
             words.emplace_back(word);
@@ -120,7 +476,197 @@ std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& t
     return words;
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
+template <typename Frequency>
+uint64_t BasicSearchServer<Frequency>::ComputeWordSetFingerprint(const std::pmr::vector<std::string_view>& words) {
+    // FNV-1a; words can't contain '\0', so it separates them
+    uint64_t hash = 14695981039346656037ull;
+    for (const std::string_view word : words) {
+        for (const char c : word) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        }
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename Frequency>
+bool BasicSearchServer<Frequency>::AdmitDocument(int document_id, const std::pmr::vector<std::string_view>& words) {
+    const uint64_t fingerprint = ComputeWordSetFingerprint(words);
+    duplicates_.erase(document_id);
+    const auto [first, last] = word_set_index_.equal_range(fingerprint);
+    for (auto entry = first; entry != last; ++entry) {
+        const WordFrequencies& word_freqs = id_to_word_freqs_.at(entry->second);
+        // Fingerprints of different sets may collide
+        const bool is_same_set = std::equal(words.begin(), words.end(), word_freqs.begin(), word_freqs.end(),
+            [](std::string_view word, const auto& word_freq) {
+                return word == word_freq.first;
+            });
+        if (is_same_set) {
+            duplicates_.emplace(document_id, entry->second);
+            if (duplicate_policy_ == DuplicatePolicy::REJECT) {
+                return false;
+            }
+            break;
+        }
+    }
+    word_set_index_.emplace(fingerprint, document_id);
+    return true;
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::UnregisterWordSet(int document_id, const WordFrequencies& word_freqs) {
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+    std::pmr::vector<std::string_view> words(scratch.Resource());
+    words.reserve(word_freqs.size());
+    for (const auto& [word, _] : word_freqs) {
+        words.push_back(word);
+    }
+    const auto [first, last] = word_set_index_.equal_range(ComputeWordSetFingerprint(words));
+    const auto entry = std::find_if(first, last, [document_id](const auto& entry) {
+        return entry.second == document_id;
+        });
+    if (entry != last) {
+        word_set_index_.erase(entry);
+    }
+}
+
+template <typename Frequency>
+bool BasicSearchServer<Frequency>::IsImpactOrdered(const Posting& lhs, const Posting& rhs) {
+    if (lhs.second != rhs.second) {
+        return lhs.second > rhs.second;
+    }
+    return (lhs.first < 0 ? ~lhs.first : lhs.first) < (rhs.first < 0 ? ~rhs.first : rhs.first);
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::SortImpactOrder(ImpactOrder& order, const Postings& postings) const {
+    order.postings.assign(postings.begin(), postings.end());
+    std::sort(order.postings.begin(), order.postings.end(), IsImpactOrdered);
+    order.added.clear();
+    order.removed_count = 0;
+    FillStatusTops(order);
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::MergeImpactOrder(ImpactOrder& order) const {
+    const size_t max_changes = std::min(IMPACT_ORDER_MAX_CHANGES, order.postings.size() / IMPACT_ORDER_CHANGES_DIVISOR);
+    if (order.added.size() + order.removed_count <= max_changes) {
+        return;
+    }
+    auto& postings = order.postings;
+    postings.erase(std::remove_if(postings.begin(), postings.end(), [](const Posting& posting) {
+        return posting.first < 0;
+        }), postings.end());
+    const size_t sorted_size = postings.size();
+    postings.insert(postings.end(), order.added.begin(), order.added.end());
+    std::inplace_merge(postings.begin(), postings.begin() + sorted_size, postings.end(), IsImpactOrdered);
+    order.added.clear();
+    order.removed_count = 0;
+    // Removals may have emptied the tops
+    FillStatusTops(order);
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::FillStatusTops(ImpactOrder& order) const {
+    for (auto& top : order.status_tops) {
+        top.postings.clear();
+        top.is_complete = true;
+    }
+    for (const Posting& posting : order.postings) {
+        auto& top = order.status_tops[static_cast<size_t>(documents_[posting.first].status)];
+        if (top.postings.size() < STATUS_TOP_SIZE) {
+            top.postings.push_back(posting);
+        }
+        else {
+            top.is_complete = false;
+        }
+    }
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::AddToImpactOrders(int ordinal, const std::pmr::vector<const Postings*>& word_postings) {
+    const DocumentStatus status = documents_[ordinal].status;
+    for (const Postings* postings : word_postings) {
+        auto impact_order = impact_orders_.find(postings);
+        if (impact_order == impact_orders_.end()) {
+            if (postings->size() >= impact_order_min_postings_) {
+                SortImpactOrder(impact_orders_.emplace(std::piecewise_construct, std::forward_as_tuple(postings),
+                    std::forward_as_tuple(&impact_order_memory_)).first->second, *postings);
+            }
+            continue;
+        }
+        ImpactOrder& order = impact_order->second;
+        const Posting posting = *postings->find(ordinal);
+        order.added.insert(std::upper_bound(order.added.begin(), order.added.end(), posting, IsImpactOrdered), posting);
+        // The top stays the leading part of its status in impact order
+        auto& top = order.status_tops[static_cast<size_t>(status)];
+        if (top.is_complete || (!top.postings.empty() && IsImpactOrdered(posting, top.postings.back()))) {
+            top.postings.insert(std::upper_bound(top.postings.begin(), top.postings.end(), posting, IsImpactOrdered),
+                posting);
+            if (top.postings.size() > STATUS_TOP_SIZE) {
+                top.postings.pop_back();
+                top.is_complete = false;
+            }
+        }
+        MergeImpactOrder(order);
+    }
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::RemoveFromImpactOrder(ImpactOrder& order, const Posting& posting, DocumentStatus status) {
+    const auto sorted = std::lower_bound(order.postings.begin(), order.postings.end(), posting, IsImpactOrdered);
+    if (sorted != order.postings.end() && sorted->first == posting.first) {
+        sorted->first = ~sorted->first;
+        ++order.removed_count;
+    }
+    else {
+        const auto added = std::lower_bound(order.added.begin(), order.added.end(), posting, IsImpactOrdered);
+        if (added != order.added.end() && *added == posting) {
+            order.added.erase(added);
+        }
+    }
+    auto& top = order.status_tops[static_cast<size_t>(status)].postings;
+    const auto top_posting = std::lower_bound(top.begin(), top.end(), posting, IsImpactOrdered);
+    if (top_posting != top.end() && *top_posting == posting) {
+        top.erase(top_posting);
+    }
+    MergeImpactOrder(order);
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::CompactOrdinals() {
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+    std::pmr::vector<int> new_ordinals(documents_.size(), -1, scratch.Resource());
+    size_t live_count = 0;
+    for (size_t ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+        if (documents_[ordinal].id >= 0) {
+            new_ordinals[ordinal] = static_cast<int>(live_count);
+            documents_[live_count++] = documents_[ordinal];
+        }
+    }
+    documents_.resize(live_count);
+    for (auto& [document_id, ordinal] : document_ordinals_) {
+        ordinal = new_ordinals[ordinal];
+    }
+    for (DocumentBitmap& bitmap : status_bitmaps_) {
+        bitmap.Clear();
+    }
+    for (size_t ordinal = 0; ordinal < live_count; ++ordinal) {
+        status_bitmaps_[static_cast<size_t>(documents_[ordinal].status)].Set(static_cast<int>(ordinal));
+    }
+    for (auto& [word, postings] : word_to_document_freqs_) {
+        postings.RemapOrdinals([&new_ordinals](int ordinal) {
+            return new_ordinals[ordinal];
+            });
+    }
+    // Cached minus word bitmaps hold old ordinals; the removal has already made them stale
+    for (auto& [postings, order] : impact_orders_) {
+        SortImpactOrder(order, *postings);
+    }
+}
+
+template <typename Frequency>
+int BasicSearchServer<Frequency>::ComputeAverageRating(const std::vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
     }
@@ -131,41 +677,329 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) const {
+template <typename Frequency>
+typename BasicSearchServer<Frequency>::QueryWord BasicSearchServer<Frequency>::ParseQueryWord(std::string_view text) const {
     if (text.empty()) {
         throw std::invalid_argument("Query word is empty"s);
     }
-    std::string word = text;
+    std::string_view word = text;
     bool is_minus = false;
     if (word[0] == '-') {
         is_minus = true;
         word = word.substr(1);
     }
     if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw std::invalid_argument("Query word "s + text + " is invalid");
+        throw std::invalid_argument("Query word "s + std::string(text) + " is invalid");
     }
+    if (word.back() == '*') {
+        word.remove_suffix(1);
+        if (word.empty()) {
+            throw std::invalid_argument("Query word "s + std::string(text) + " has an empty prefix");
+        }
+        return { word, is_minus, false, true };
+    }
+
+    return { word, is_minus, IsStopWord(word), false };
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::ExpandPrefix(std::string_view prefix, std::pmr::vector<std::string_view>& words) const {
+    {
+        std::shared_lock lock(prefix_index_mutex_);
+        if (prefix_index_) {
+            ExpandPrefix(*prefix_index_, prefix, words);
+            return;
+        }
+    }
+    std::unique_lock lock(prefix_index_mutex_);
+    if (!prefix_index_) {
+        BuildPrefixIndex();
+    }
+    ExpandPrefix(*prefix_index_, prefix, words);
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::ExpandPrefix(const PrefixIndex& prefix_index, std::string_view prefix,
+    std::pmr::vector<std::string_view>& words) const {
+    // Terms and added words with the prefix are merged in lexicographic order
+    const auto [first, last] = prefix_index.terms.FindPrefixRange(prefix);
+    size_t index = first;
+    auto added = prefix_index.added_words.lower_bound(prefix);
+    std::string term;
+    for (size_t expansion_count = 0; expansion_count < max_prefix_expansions_; ++expansion_count) {
+        for (; index < last; ++index) {
+            term = prefix_index.terms.GetTerm(index);
+            if (prefix_index.removed_words.count(term) == 0) {
+                break;
+            }
+        }
+        const bool has_term = index < last;
+        const bool has_added = added != prefix_index.added_words.end() && added->starts_with(prefix);
+        if (has_term && (!has_added || term < *added)) {
+            words.push_back(word_to_document_freqs_.find(std::string_view(term))->first);
+            ++index;
+        }
+        else if (has_added) {
+            words.push_back(*added++);
+        }
+        else {
+            break;
+        }
+    }
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::BuildPrefixIndex() const {
+    std::vector<std::string_view> terms;
+    terms.reserve(word_to_document_freqs_.size());
+    for (const auto& [word, _] : word_to_document_freqs_) {
+        terms.push_back(word);
+    }
+    prefix_index_.emplace();
+    prefix_index_->terms = TermDictionary(terms);
+}
 
-    return { word, is_minus, IsStopWord(word) };
+template <typename Frequency>
+void BasicSearchServer<Frequency>::AddToPrefixIndex(std::string_view word) {
+    std::unique_lock lock(prefix_index_mutex_);
+    if (!prefix_index_) {
+        return;
+    }
+    const auto removed = prefix_index_->removed_words.find(word);
+    if (removed != prefix_index_->removed_words.end()) {
+        prefix_index_->removed_words.erase(removed);
+    }
+    else {
+        prefix_index_->added_words.insert(word);
+    }
+    MergePrefixIndexChanges();
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
-    Query result;
-    for (const std::string& word : SplitIntoWords(text)) {
+template <typename Frequency>
+void BasicSearchServer<Frequency>::RemoveFromPrefixIndex(std::string_view word) {
+    std::unique_lock lock(prefix_index_mutex_);
+    if (!prefix_index_) {
+        return;
+    }
+    // The last word is going away, an empty index needs no terms
+    if (word_to_document_freqs_.size() == 1) {
+        prefix_index_.reset();
+        return;
+    }
+    if (prefix_index_->added_words.erase(word) == 0) {
+        prefix_index_->removed_words.emplace(word);
+    }
+    MergePrefixIndexChanges();
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::MergePrefixIndexChanges() {
+    // The merge reads the whole vocabulary, so it waits for changes in proportion to it
+    if (prefix_index_->added_words.size() + prefix_index_->removed_words.size()
+        > std::max(PREFIX_INDEX_MIN_CHANGES, prefix_index_->terms.GetTermCount() / PREFIX_INDEX_CHANGES_DIVISOR)) {
+        BuildPrefixIndex();
+    }
+}
+
+template <typename Frequency>
+void BasicSearchServer<Frequency>::ParseQuery(std::string_view text, ParsedQuery& result, std::pmr::memory_resource* scratch) const {
+    result.Clear();
+    for (const std::string_view word : SplitIntoWordsView(text, scratch)) {
         const auto& query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (query_word.is_prefix) {
+            ExpandPrefix(query_word.data, query_word.is_minus ? result.minus_words : result.plus_words);
+        }
+        else if (!query_word.is_stop) {
             if (query_word.is_minus) {
-                result.minus_words.emplace(query_word.data);
+                result.minus_words.push_back(query_word.data);
             }
             else {
-                result.plus_words.emplace(query_word.data);
+                result.plus_words.push_back(query_word.data);
+            }
+        }
+    }
+    for (auto* words : { &result.plus_words, &result.minus_words }) {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
+}
+
+template <typename Frequency>
+double BasicSearchServer<Frequency>::ComputeInverseDocumentFreq(int document_count, int document_freq) {
+    return log(document_count * 1.0 / document_freq);
+}
+
+template <typename Frequency>
+typename BasicSearchServer<Frequency>::ResolvedQuery BasicSearchServer<Frequency>::ResolveQuery(const ParsedQuery& query, const TermStatistics* statistics,
+    std::pmr::memory_resource* resource) const {
+    ResolvedQuery result(resource);
+    result.plus_terms.reserve(query.plus_words.size());
+    for (const std::string_view word : query.plus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
+            continue;
+        }
+        int document_count = GetDocumentCount();
+        int document_freq = static_cast<int>(postings->second.size());
+        if (statistics) {
+            const auto global_freq = statistics->document_freqs.find(word);
+            if (global_freq != statistics->document_freqs.end() && global_freq->second > 0) {
+                document_count = statistics->document_count;
+                document_freq = global_freq->second;
             }
         }
+        result.plus_terms.push_back({ &postings->second,
+            static_cast<Frequency>(ComputeInverseDocumentFreq(document_count, document_freq)) });
+    }
+    // Short lists first: they are cheap to probe and keep id-set candidates small
+    std::sort(result.plus_terms.begin(), result.plus_terms.end(),
+        [](const PlusTerm& lhs, const PlusTerm& rhs) {
+            return lhs.postings->size() < rhs.postings->size();
+        });
+
+    // Excluded documents are known before any score is accumulated, so they are skipped, not erased
+    for (const std::string_view word : query.minus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings == word_to_document_freqs_.end()) {
+            continue;
+        }
+        if (postings->second.size() >= MIN_CACHED_MINUS_POSTINGS) {
+            result.excluded.Union(*GetMinusWordDocuments(word, postings->second));
+            continue;
+        }
+        for (const auto& [ordinal, _] : postings->second) {
+            result.excluded.Set(ordinal);
+        }
     }
     return result;
 }
 
-// Existence required
+template <typename Frequency>
+std::pmr::vector<Document> BasicSearchServer<Frequency>::FindAllDocuments(const ResolvedQuery& query, const DocumentFilter& filter,
+    std::pmr::memory_resource* resource, OrdinalRange range) const {
+    ThreadLocalScoreAccumulator<Frequency> accumulator(documents_.size());
+    if (filter.matches_nothing) {
+        return CollectDocuments(*accumulator, resource);
+    }
+    const DocumentBitmap* status_bitmap = filter.status ? &status_bitmaps_[static_cast<size_t>(*filter.status)] : nullptr;
+    const bool check_rating = filter.HasRatingRange();
+    const auto passes = [&](int ordinal) {
+        if (query.excluded.Test(ordinal) || (status_bitmap && !status_bitmap->Test(ordinal))) {
+            return false;
+        }
+        const int rating = documents_[ordinal].rating;
+        return !check_rating || (rating >= filter.min_rating && rating <= filter.max_rating);
+    };
+
+    // With an id set, candidates are resolved to ordinals once; short candidate lists
+    // are probed in the postings, long ones become a bitmap tested while scanning
+    std::pmr::vector<int> candidates(resource);
+    DocumentBitmap candidate_bitmap(resource);
+    if (filter.has_ids) {
+        for (const int document_id : filter.ids) {
+            const auto ordinal = document_ordinals_.find(document_id);
+            if (ordinal != document_ordinals_.end() && ordinal->second >= range.begin && ordinal->second < range.end
+                && passes(ordinal->second)) {
+                candidates.push_back(ordinal->second);
+                candidate_bitmap.Set(ordinal->second);
+            }
+        }
+    }
+
+    for (const auto [postings, inverse_document_freq] : query.plus_terms) {
+        const auto& document_freqs = *postings;
+        const auto range_begin = document_freqs.lower_bound(range.begin);
+        const auto range_end = document_freqs.lower_bound(range.end);
+        if (filter.has_ids && candidates.size() < document_freqs.size()) {
+            for (const int ordinal : candidates) {
+                const auto term_freq = document_freqs.find(ordinal);
+                if (term_freq != document_freqs.end()) {
+                    accumulator->Add(ordinal, term_freq->second * inverse_document_freq);
+                }
+            }
+        }
+        else if (filter.has_ids) {
+            for (auto posting = range_begin; posting != range_end; ++posting) {
+                if (candidate_bitmap.Test(posting->first)) {
+                    accumulator->Add(posting->first, posting->second * inverse_document_freq);
+                }
+            }
+        }
+        else {
+            for (auto posting = range_begin; posting != range_end; ++posting) {
+                if (passes(posting->first)) {
+                    accumulator->Add(posting->first, posting->second * inverse_document_freq);
+                }
+            }
+        }
+    }
+
+    return CollectDocuments(*accumulator, resource);
+}
+
+template <typename Frequency>
+bool BasicSearchServer<Frequency>::IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= COMPARISON_ACCURACY_FOR_DOUBLE) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+template <typename Frequency>
+std::shared_ptr<const DocumentBitmap> BasicSearchServer<Frequency>::GetMinusWordDocuments(std::string_view word,
+    const Postings& postings) const {
+    {
+        std::lock_guard guard(minus_word_cache_mutex_);
+        const auto cached = minus_word_cache_.find(word);
+        if (cached != minus_word_cache_.end() && cached->second.generation == generation_) {
+            ++cached->second.hit_count;
+            return cached->second.documents;
+        }
+    }
+
+    auto documents = std::make_shared<DocumentBitmap>();
+    for (const auto& [ordinal, _] : postings) {
+        documents->Set(ordinal);
+    }
+
+    std::lock_guard guard(minus_word_cache_mutex_);
+    auto cached = minus_word_cache_.find(word);
+    if (cached == minus_word_cache_.end()) {
+        if (minus_word_cache_.size() >= MAX_CACHED_MINUS_WORDS) {
+            // Stale entries go first, then the least used one
+            const auto evicted = std::min_element(minus_word_cache_.begin(), minus_word_cache_.end(),
+                [this](const auto& lhs, const auto& rhs) {
+                    return std::make_pair(lhs.second.generation == generation_, lhs.second.hit_count)
+                        < std::make_pair(rhs.second.generation == generation_, rhs.second.hit_count);
+                });
+            minus_word_cache_.erase(evicted);
+            // Aging: a word stays only as long as it keeps being hit between evictions
+            for (auto& [_, entry] : minus_word_cache_) {
+                entry.hit_count /= 2;
+            }
+        }
+        cached = minus_word_cache_.emplace(std::string(word), CachedMinusWord{}).first;
+    }
+    cached->second.documents = documents;
+    cached->second.generation = generation_;
+    ++cached->second.hit_count;
+    return documents;
+}
+
+template <typename Frequency>
+std::pmr::vector<Document> BasicSearchServer<Frequency>::CollectDocuments(const ScoreAccumulator<Frequency>& accumulator,
+    std::pmr::memory_resource* resource) const {
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(accumulator.GetTouched().size());
+    for (const int ordinal : accumulator.GetTouched()) {
+        const auto& document_data = documents_[ordinal];
+        matched_documents.push_back({ document_data.id, accumulator.Get(ordinal), document_data.rating });
+    }
+    return matched_documents;
+}
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
-}
\ No newline at end of file
+template class BasicSearchServer<double>;
+template class BasicSearchServer<float>;
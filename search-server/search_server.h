@@ -1,13 +1,41 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <future>
+#include <istream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <ostream>
 #include <set>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "document.h"
+#include "document_bitmap.h"
+#include "counting_resource.h"
+#include "document_predicates.h"
+#include "posting_list.h"
+#include "query_arena.h"
+#include "query_context.h"
+#include "score_accumulator.h"
+#include "search_budget.h"
+#include "search_cursor.h"
+#include "term_dictionary.h"
+#include "term_statistics.h"
+#include "thread_pool.h"
 
 #include "string_processing.h"
 
@@ -17,18 +45,60 @@ using std::vector;
 using std::string;
 using std::set;
 
-class SearchServer {
+struct IndexMemoryStats {
+    // Word -> posting list map: tree nodes and word strings
+    size_t dictionary_bytes = 0;
+    // Posting arrays, including their unused capacity
+    size_t postings_bytes = 0;
+    // Word frequencies of every document (GetWordFrequencies)
+    size_t forward_index_bytes = 0;
+    // Document data, ordinal map, status bitmaps; the id set behind begin() and end() is on the heap
+    size_t metadata_bytes = 0;
+    // Impact-ordered copies of long posting lists, see SetImpactOrderThreshold
+    size_t impact_order_bytes = 0;
+    // Structures rebuilt on demand, such as the prefix dictionary
+    size_t cache_bytes = 0;
+    // Taken from the system by the pool but not in use: free lists and partly used chunks
+    size_t allocator_overhead_bytes = 0;
+    size_t total_bytes = 0;
+
+    size_t vocabulary_size = 0;
+    size_t document_count = 0;
+    size_t posting_count = 0;
+    double average_posting_length = 0.0;
+};
+
+// What AddDocument does with a document whose set of words equals that of an indexed document
+enum class DuplicatePolicy {
+    // Indexes it without checking; duplicates can be removed later with RemoveDuplicates
+    ALLOW,
+    // Doesn't index it and records it in GetDuplicates
+    REJECT,
+    // Indexes it and records it in GetDuplicates
+    RECORD,
+};
+
+// Frequency is the type term frequencies are stored in, in the posting lists and in the forward index,
+// and relevance is summed in. SearchServer keeps double; CompactSearchServer keeps float, so a posting
+// takes 8 bytes instead of 16 and relevance stays within COMPARISON_ACCURACY_FOR_DOUBLE of SearchServer
+// for ordinary corpora (checked by TestPostingStorageMode). Snapshots store double either way.
+template <typename Frequency>
+class BasicSearchServer {
 public:
 
     inline static constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
+    inline static constexpr size_t BUDGET_CHECK_INTERVAL = 1024;
     inline static constexpr double COMPARISON_ACCURACY_FOR_DOUBLE = 1e-6;
+    inline static constexpr size_t DEFAULT_MAX_PREFIX_EXPANSIONS = 64;
+
+    using WordFrequencies = std::pmr::map<std::pmr::string, Frequency, std::less<>>;
 
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit BasicSearchServer(const StringContainer& stop_words);
 
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit BasicSearchServer(const std::string& stop_words_text);
 
-    explicit SearchServer();
+    explicit BasicSearchServer();
 
     void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
     
@@ -39,124 +109,1109 @@ public:
 
     std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
 
+    // Best-effort ranking within a budget: plus words are scored rarest first, and traversal stops
+    // once max_postings postings are visited or the deadline passes (checked every
+    // BUDGET_CHECK_INTERVAL postings). Documents are then ranked by the scores gathered so far.
+    template <typename DocumentPredicate>
+    BudgetedResult FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate,
+        const SearchBudget& budget) const;
+
+    BudgetedResult FindTopDocuments(const std::string& raw_query, DocumentStatus status, const SearchBudget& budget) const;
+
+    BudgetedResult FindTopDocuments(const std::string& raw_query, const SearchBudget& budget) const;
+
+    // Ranks documents with IDF taken from the statistics instead of this index, so a part
+    // of a corpus returns the same relevance as an index over the whole corpus
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate,
+        const TermStatistics& statistics) const;
+
+    // Document count of this index and document frequencies of the query's plus words in it
+    TermStatistics GetTermStatistics(const std::string& raw_query) const;
+
+    // Same as above, but all buffers come from the context, which is reused between calls.
+    // The returned reference points into the context and is valid until its next query.
+    template <typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string& raw_query,
+        DocumentPredicate document_predicate) const;
+
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string& raw_query, DocumentStatus status) const;
+
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string& raw_query) const;
+
+    // Ranks several queries at once, returning what FindTopDocuments returns for each, in query order
+    // (relevance may differ by rounding). Queries sharing their longest plus word are evaluated together
+    // in groups of BATCH_GROUP_SIZE: every distinct plus word's posting list is read once per group,
+    // the predicate is called once per posting, and the scores go to all queries that have the word.
+    template <typename DocumentPredicate>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+        DocumentPredicate document_predicate) const;
+
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+        DocumentStatus status) const;
+
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const;
+
+    // Runs the query on the pool. Queries with many postings are split into sub-tasks over
+    // ordinal ranges, which idle workers steal. The server must not be modified until the future is ready.
+    template <typename DocumentPredicate>
+    std::future<std::vector<Document>> FindTopDocumentsAsync(ThreadPool& pool, const std::string& raw_query,
+        DocumentPredicate document_predicate) const;
+
+    std::future<std::vector<Document>> FindTopDocumentsAsync(ThreadPool& pool, const std::string& raw_query, DocumentStatus status) const;
+
+    std::future<std::vector<Document>> FindTopDocumentsAsync(ThreadPool& pool, const std::string& raw_query) const;
+
+    // Search-after pagination: the page_size best documents ranked after the cursor, or from the top
+    // without one. Nothing is kept between calls. Matched documents are scored one at a time, those
+    // not ranked after the cursor are dropped at once and the rest go through a heap of page_size
+    // documents, so a page takes O(page_size) memory and nothing else is collected or sorted.
+    template <typename DocumentPredicate>
+    ResultPage FindTopDocumentsAfter(const std::string& raw_query, DocumentPredicate document_predicate,
+        const std::optional<SearchCursor>& after, size_t page_size) const;
+
+    ResultPage FindTopDocumentsAfter(const std::string& raw_query, DocumentStatus status,
+        const std::optional<SearchCursor>& after, size_t page_size) const;
+
+    ResultPage FindTopDocumentsAfter(const std::string& raw_query, const std::optional<SearchCursor>& after, size_t page_size) const;
+
+    // Scores the query once; pages of all matched documents are then taken from the pager lazily.
+    // The pager owns its results and stays valid after the server changes.
+    template <typename DocumentPredicate>
+    ResultPager FindDocumentPages(const std::string& raw_query, DocumentPredicate document_predicate) const;
+
+    ResultPager FindDocumentPages(const std::string& raw_query, DocumentStatus status) const;
+
+    ResultPager FindDocumentPages(const std::string& raw_query) const;
+
+    // Unranked streaming: calls sink(const Document&) for every matched document as the merged
+    // posting lists reach it, in internal order. Minus words are merged in as cursors too, so memory
+    // depends only on the number of query words, not on the matches or the size of the index.
+    // A sink returning bool stops the traversal by returning false. The sink must not modify the server.
+    template <typename DocumentPredicate, typename DocumentSink>
+    void ForEachMatchedDocument(const std::string& raw_query, DocumentPredicate document_predicate, DocumentSink sink) const;
+
+    template <typename DocumentSink>
+    void ForEachMatchedDocument(const std::string& raw_query, DocumentStatus status, DocumentSink sink) const;
+
+    template <typename DocumentSink>
+    void ForEachMatchedDocument(const std::string& raw_query, DocumentSink sink) const;
+
+    // A query word ending with '*' (pet*, -pet*) stands for the indexed words starting with it,
+    // the first max_expansions of them in lexicographic order; each is ranked as a separate plus word
+    void SetMaxPrefixExpansions(size_t max_expansions);
+
+    // Anything but ALLOW keeps a hash index of word sets, so duplicates are found as they are added,
+    // before their postings are written. Documents indexed before the switch are not checked.
+    void SetDuplicatePolicy(DuplicatePolicy policy);
+
+    // Id of every duplicate found on adding -> id of the indexed document it repeated then.
+    // A duplicate leaves the list when it is removed or its id is added again.
+    const std::pmr::map<int, int>& GetDuplicates() const;
+
+    // Posting lists of at least min_postings postings get a copy sorted by term frequency, with the
+    // leading postings of every status kept apart; updates maintain both. Top documents of queries
+    // on such words are then found in a prefix of the copies instead of scoring the whole lists,
+    // with the same results. 0, the default, turns the copies off.
+    void SetImpactOrderThreshold(size_t min_postings);
+
+    // Bytes held by each part of the index and its size; O(1), cheap enough to export as a metric
+    IndexMemoryStats GetMemoryStats() const;
+
     int GetDocumentCount() const;
 
+    bool HasDocument(int document_id) const;
+
     std::set<int>::const_iterator begin() const;
 
     std::set<int>::const_iterator end() const;
 
+    // A copy made on the first call for the document and kept until the document is removed,
+    // so the reference stays valid as long as before. The copies are not counted in GetMemoryStats;
+    // GetIndexedWordFrequencies avoids them.
     const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
 
+    // The document's words as the index stores them, valid until the document is removed
+    const WordFrequencies& GetIndexedWordFrequencies(int document_id) const;
+
+    // Leaves a tombstone in the posting list of every word of the document. Ordinals are not reused:
+    // once removed documents hold more than half of them, all ordinals are renumbered in one pass
+    // over the index, so a removal costs amortized O(log n) per word.
     void RemoveDocument(int document_id);
 
+    // Adds an indexed document of another server (words, rating and status) without re-tokenizing its text
+    void CopyDocumentFrom(const BasicSearchServer& source, int document_id);
+
+    // Binary dump of the indexed documents: ids, statuses, ratings and word frequencies, without the
+    // stop words. Loading it into a server with the same stop words needs no tokenizing.
+    void SaveSnapshot(std::ostream& output) const;
+
+    // Adds the documents of a snapshot; throws std::runtime_error if it is malformed or truncated
+    // and std::invalid_argument if a document id is already present
+    void LoadSnapshot(std::istream& input);
+
     std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
 
+    std::future<std::tuple<std::vector<std::string>, DocumentStatus>> MatchDocumentAsync(ThreadPool& pool,
+        const std::string& raw_query, int document_id) const;
+
+    // Ranking order: relevance descending, then rating descending, then id ascending
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
 
+    // Sorts in ranking order and cuts to MAX_RESULT_DOCUMENT_COUNT;
+    // also merges top documents found by several indexes
+    template <typename Documents>
+    static void KeepTopDocuments(Documents& documents);
 
 private:
+    inline static constexpr size_t DOCUMENT_STATUS_COUNT = 4;
+    // "SNP1" in little-endian; changes with the snapshot format
+    inline static constexpr uint32_t SNAPSHOT_MAGIC = 0x31504E53;
+    // Parallel queries get one sub-task per this many postings, but no more than there are workers
+    inline static constexpr size_t MIN_POSTINGS_PER_TASK = 16 * 1024;
+    // Minus words with at least this many postings get their bitmap cached
+    inline static constexpr size_t MIN_CACHED_MINUS_POSTINGS = 4 * 1024;
+    inline static constexpr size_t MAX_CACHED_MINUS_WORDS = 32;
+    // Queries sharing one traversal in FindTopDocumentsBatch
+    inline static constexpr size_t BATCH_GROUP_SIZE = BatchScoreAccumulator<Frequency>::MAX_QUERY_COUNT;
+    // Leading postings of each status kept with an impact order
+    inline static constexpr size_t STATUS_TOP_SIZE = 4 * MAX_RESULT_DOCUMENT_COUNT;
+    // Vocabulary changes are merged into the prefix index once there are this many of them,
+    // or an eighth of its terms if that is more
+    inline static constexpr size_t PREFIX_INDEX_MIN_CHANGES = 1024;
+    inline static constexpr size_t PREFIX_INDEX_CHANGES_DIVISOR = 8;
+    // Added and removed postings are merged into an impact order once there are this many of them,
+    // or an eighth of the order if that is less
+    inline static constexpr size_t IMPACT_ORDER_MAX_CHANGES = 4 * 1024;
+    inline static constexpr size_t IMPACT_ORDER_CHANGES_DIVISOR = 8;
+    // An impact-ordered traversal reading more than this share of its postings gives way to the full scan
+    inline static constexpr size_t IMPACT_SCAN_LIMIT_DIVISOR = 4;
+
+    // Documents are addressed by an internal ordinal in order of addition; a removed document keeps
+    // its slot, with id -1, until CompactOrdinals
     struct DocumentData {
+        int id;
         int rating;
         DocumentStatus status;
     };
 
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    // Keyed by ordinal
+    using Postings = PostingList<Frequency>;
+    using Posting = typename Postings::value_type;
+
+    // Copy of a long posting list sorted by term frequency descending, then by ordinal.
+    // Updates don't shift the long array: removed postings stay in place as ~ordinal, added ones
+    // go to a short sorted run, and both are merged in from time to time.
+    struct ImpactOrder {
+        // First postings of one status in impact order; all of them if is_complete
+        struct StatusTop {
+            explicit StatusTop(std::pmr::memory_resource* resource)
+                : postings(resource) {
+            }
+
+            std::pmr::vector<Posting> postings;
+            bool is_complete = false;
+        };
+
+        explicit ImpactOrder(std::pmr::memory_resource* resource)
+            : postings(resource), added(resource),
+            status_tops{ StatusTop(resource), StatusTop(resource), StatusTop(resource), StatusTop(resource) } {
+        }
+
+        std::pmr::vector<Posting> postings;
+        std::pmr::vector<Posting> added;
+        size_t removed_count = 0;
+        std::array<StatusTop, DOCUMENT_STATUS_COUNT> status_tops;
+    };
+
+    // Half-open range of ordinals a (sub-)query is evaluated on
+    struct OrdinalRange {
+        int begin = 0;
+        int end = std::numeric_limits<int>::max();
+    };
+
+    const std::set<std::string, std::less<>> stop_words_;
+    // All index containers allocate from this pool, so it must be declared before them.
+    // Every component goes through its own counter to the pool, see GetMemoryStats
+    CountingResource system_memory_;
+    std::pmr::unsynchronized_pool_resource index_resource_{ &system_memory_ };
+    CountingResource dictionary_memory_{ &index_resource_ };
+    CountingResource postings_memory_{ &index_resource_ };
+    CountingResource forward_index_memory_{ &index_resource_ };
+    CountingResource metadata_memory_{ &index_resource_ };
+    CountingResource impact_order_memory_{ &index_resource_ };
+    // word -> ordinal -> term frequency
+    std::pmr::map<std::pmr::string, Postings, std::less<>> word_to_document_freqs_{ &dictionary_memory_ };
+    std::pmr::vector<DocumentData> documents_{ &metadata_memory_ };
+    std::pmr::map<int, int> document_ordinals_{ &metadata_memory_ };
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_bitmaps_{ DocumentBitmap(&metadata_memory_),
+        DocumentBitmap(&metadata_memory_), DocumentBitmap(&metadata_memory_), DocumentBitmap(&metadata_memory_) };
     std::set<int> document_ids_;
-    std::map<int, std::map<std::string, double>> id_to_word_freqs_;
+    std::pmr::map<int, WordFrequencies> id_to_word_freqs_{ &forward_index_memory_ };
+    // Copies handed out by GetWordFrequencies
+    mutable std::mutex word_frequencies_copies_mutex_;
+    mutable std::map<int, std::map<std::string, double>> word_frequencies_copies_;
+    size_t posting_count_ = 0;
+
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    // Word set fingerprint -> ids of the documents having it; empty under DuplicatePolicy::ALLOW
+    std::pmr::unordered_multimap<uint64_t, int> word_set_index_{ &metadata_memory_ };
+    std::pmr::map<int, int> duplicates_{ &metadata_memory_ };
+
+    size_t impact_order_min_postings_ = 0;
+    // Keyed by the posting list the order is a copy of
+    std::pmr::unordered_map<const Postings*, ImpactOrder> impact_orders_{ &impact_order_memory_ };
+
+    // Front-coded copy of the vocabulary for prefix queries, built by the first prefix query.
+    // Later updates don't discard it: words added and removed since it was built are kept beside
+    // the terms and merged into them once there are enough of them. Expanded terms are mapped to
+    // their postings by a lookup in the index, so no per-term pointers are kept.
+    struct PrefixIndex {
+        TermDictionary terms;
+        // Index keys of the words missing from the terms
+        std::set<std::string_view> added_words;
+        // Terms no longer in the index
+        std::set<std::string, std::less<>> removed_words;
+    };
+
+    size_t max_prefix_expansions_ = DEFAULT_MAX_PREFIX_EXPANSIONS;
+    // Prefix queries share the index; building it and updates take the lock exclusively
+    mutable std::shared_mutex prefix_index_mutex_;
+    mutable std::optional<PrefixIndex> prefix_index_;
+
+    // Documents of frequent minus words; entries made before the last update are stale
+    struct CachedMinusWord {
+        std::shared_ptr<const DocumentBitmap> documents;
+        size_t generation;
+        // Halved on every eviction, so words that were hot long ago don't stay cached for good
+        size_t hit_count;
+    };
 
-    bool IsStopWord(const std::string& word) const;
+    // Changes with every update of the index
+    size_t generation_ = 0;
+    mutable std::mutex minus_word_cache_mutex_;
+    mutable std::map<std::string, CachedMinusWord, std::less<>> minus_word_cache_;
 
-    static bool IsValidWord(const std::string& word);
+    bool IsStopWord(std::string_view word) const;
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    static bool IsValidWord(std::string_view word);
+
+    std::pmr::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, std::pmr::memory_resource* resource) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // Hash of a sorted set of words
+    static uint64_t ComputeWordSetFingerprint(const std::pmr::vector<std::string_view>& words);
+
+    // Checks the sorted set of words of a new document against the word set index and applies
+    // the duplicate policy; returns false if the document must not be indexed
+    bool AdmitDocument(int document_id, const std::pmr::vector<std::string_view>& words);
+
+    void UnregisterWordSet(int document_id, const WordFrequencies& word_freqs);
+
+    // Impact order: term frequency descending, then ordinal ascending; removed postings compare as live ones
+    static bool IsImpactOrdered(const Posting& lhs, const Posting& rhs);
+
+    // Copies and sorts the posting list
+    void SortImpactOrder(ImpactOrder& order, const Postings& postings) const;
+
+    // Merges the added postings into the sorted ones and drops the removed ones once there are enough of them
+    void MergeImpactOrder(ImpactOrder& order) const;
+
+    // Refills the status tops from the sorted postings
+    void FillStatusTops(ImpactOrder& order) const;
+
+    // Updates the impact orders of the posting lists a new document was added to,
+    // creating those that reach the threshold
+    void AddToImpactOrders(int ordinal, const std::pmr::vector<const Postings*>& word_postings);
+
+    // Called before the posting is erased from its list
+    void RemoveFromImpactOrder(ImpactOrder& order, const Posting& posting, DocumentStatus status);
+
+    // Renumbers the live documents densely in the same order, dropping the slots and tombstones
+    // of removed ones from the document data, the bitmaps, the posting lists and the impact orders
+    void CompactOrdinals();
+
+    // Indexes a document given its (word, term frequency) pairs sorted by word
+    template <typename WordFreqs>
+    void AddIndexedDocument(const DocumentData& data, const WordFreqs& word_freqs);
+
     struct QueryWord {
-        std::string data;
+        std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
     };
 
-    QueryWord ParseQueryWord(const std::string& text) const;
+    QueryWord ParseQueryWord(std::string_view text) const;
+
+    // Adds the indexed words starting with the prefix, up to max_prefix_expansions_
+    void ExpandPrefix(std::string_view prefix, std::pmr::vector<std::string_view>& words) const;
+
+    // Same, from the built prefix index
+    void ExpandPrefix(const PrefixIndex& prefix_index, std::string_view prefix, std::pmr::vector<std::string_view>& words) const;
+
+    // Builds the terms from the current vocabulary, with empty changes
+    void BuildPrefixIndex() const;
+
+    // Called by updates after a word gets its first posting and before it loses its last one
+    void AddToPrefixIndex(std::string_view word);
+
+    void RemoveFromPrefixIndex(std::string_view word);
+
+    // Rebuilds the terms once enough changes are kept beside them; called under prefix_index_mutex_
+    void MergePrefixIndexChanges();
+
+    // Words are split in the scratch resource, result keeps its own storage
+    void ParseQuery(std::string_view text, ParsedQuery& result, std::pmr::memory_resource* scratch) const;
 
-    struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+    static double ComputeInverseDocumentFreq(int document_count, int document_freq);
+
+    struct PlusTerm {
+        const Postings* postings;
+        Frequency inverse_document_freq;
     };
 
-    Query ParseQuery(const std::string& text) const;
+    // Query words resolved to their posting lists, shortest first; words missing from the index
+    // are dropped. Minus words are resolved into the bitmap of excluded ordinals.
+    struct ResolvedQuery {
+        explicit ResolvedQuery(std::pmr::memory_resource* resource)
+            : plus_terms(resource), excluded(resource) {
+        }
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+        std::pmr::vector<PlusTerm> plus_terms;
+        DocumentBitmap excluded;
+    };
 
+    // IDF comes from the statistics when they are given, otherwise from this index
+    ResolvedQuery ResolveQuery(const ParsedQuery& query, const TermStatistics* statistics,
+        std::pmr::memory_resource* resource) const;
+
+    // Matched documents sorted by relevance and cut to MAX_RESULT_DOCUMENT_COUNT
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    std::pmr::vector<Document> FindTopCandidates(const ResolvedQuery& query, DocumentPredicate document_predicate,
+        std::pmr::memory_resource* resource, OrdinalRange range = {}) const;
+
+    // Top documents read from the impact orders of the plus words that have one (threshold algorithm):
+    // other plus words are scored whole, the ordered lists only until no unread document can enter
+    // the top. Empty if no plus word has an impact order or the traversal would read too much.
+    template <typename DocumentPredicate>
+    std::optional<std::pmr::vector<Document>> FindTopByImpact(const ResolvedQuery& query,
+        DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsParallel(ThreadPool& pool, const std::string& raw_query,
+        DocumentPredicate document_predicate) const;
+
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const ResolvedQuery& query, DocumentPredicate document_predicate,
+        std::pmr::memory_resource* resource, OrdinalRange range) const;
+
+    // Kernel for index predicates: status comes from the bitmaps, id sets are probed in the postings
+    std::pmr::vector<Document> FindAllDocuments(const ResolvedQuery& query, const DocumentFilter& filter,
+        std::pmr::memory_resource* resource, OrdinalRange range) const;
+
+    // Bitmap of the documents of a long minus word, from the cache when it is up to date
+    std::shared_ptr<const DocumentBitmap> GetMinusWordDocuments(std::string_view word, const Postings& postings) const;
+
+    std::pmr::vector<Document> CollectDocuments(const ScoreAccumulator<Frequency>& accumulator,
+        std::pmr::memory_resource* resource) const;
 };
 
+// Members that are not templates are defined in search_server.cpp for these two
+using SearchServer = BasicSearchServer<double>;
+using CompactSearchServer = BasicSearchServer<float>;
+
+template <typename Frequency>
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words) : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+BasicSearchServer<Frequency>::BasicSearchServer(const StringContainer& stop_words) : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
 {
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid"s);
     }
 }
 
+template <typename Frequency>
+template <typename WordFreqs>
+void BasicSearchServer<Frequency>::AddIndexedDocument(const DocumentData& data, const WordFreqs& word_freqs) {
+    if ((data.id < 0) || (document_ordinals_.count(data.id) > 0)) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        QueryArena::Scope scratch(ThreadLocalQueryArena());
+        std::pmr::vector<std::string_view> words(scratch.Resource());
+        words.reserve(word_freqs.size());
+        for (const auto& [word, _] : word_freqs) {
+            words.push_back(word);
+        }
+        if (!AdmitDocument(data.id, words)) {
+            return;
+        }
+    }
+    ++generation_;
+
+    const int ordinal = static_cast<int>(documents_.size());
+    documents_.push_back(data);
+    document_ordinals_.emplace(data.id, ordinal);
+    status_bitmaps_[static_cast<size_t>(data.status)].Set(ordinal);
+
+    auto& document_freqs = id_to_word_freqs_[data.id];
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+    std::pmr::vector<const Postings*> word_postings(scratch.Resource());
+    for (const auto& [word_data, term_freq] : word_freqs) {
+        const std::string_view word = word_data;
+        auto postings = word_to_document_freqs_.lower_bound(word);
+        if (postings == word_to_document_freqs_.end() || postings->first != word) {
+            postings = word_to_document_freqs_.emplace_hint(postings, std::piecewise_construct,
+                std::forward_as_tuple(word), std::forward_as_tuple(&postings_memory_));
+            AddToPrefixIndex(postings->first);
+        }
+        postings->second.emplace(ordinal, term_freq);
+        document_freqs.emplace_hint(document_freqs.end(), word, term_freq);
+        ++posting_count_;
+        if (impact_order_min_postings_ > 0) {
+            word_postings.push_back(&postings->second);
+        }
+    }
+    if (impact_order_min_postings_ > 0) {
+        AddToImpactOrders(ordinal, word_postings);
+    }
+    document_ids_.emplace(data.id);
+}
+
+template <typename Frequency>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query,
+std::vector<Document> BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query,
     DocumentPredicate document_predicate) const {
 
-    const auto query = ParseQuery(raw_query);
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    ParsedQuery query(scratch.Resource());
+    ParseQuery(raw_query, query, scratch.Resource());
 
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+    const auto matched_documents = FindTopCandidates(ResolveQuery(query, nullptr, scratch.Resource()),
+        document_predicate, scratch.Resource());
 
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < COMPARISON_ACCURACY_FOR_DOUBLE) {
-                return lhs.rating > rhs.rating;
+    return { matched_documents.begin(), matched_documents.end() };
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+BudgetedResult BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate,
+    const SearchBudget& budget) const {
+
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    ParsedQuery parsed_query(scratch.Resource());
+    ParseQuery(raw_query, parsed_query, scratch.Resource());
+    // Plus terms come shortest first, and rare words carry the largest IDF
+    const auto query = ResolveQuery(parsed_query, nullptr, scratch.Resource());
+
+    BudgetedResult result;
+    ThreadLocalScoreAccumulator<Frequency> accumulator(documents_.size());
+    for (const auto [postings, inverse_document_freq] : query.plus_terms) {
+        // Postings left before the budget is checked again
+        size_t chunk_left = 0;
+        for (const auto& [ordinal, term_freq] : *postings) {
+            if (chunk_left == 0) {
+                const size_t budget_left = budget.max_postings - result.visited_postings;
+                if (budget_left == 0 || SearchClock::now() >= budget.deadline) {
+                    result.is_partial = true;
+                    break;
+                }
+                chunk_left = std::min(budget_left, BUDGET_CHECK_INTERVAL);
             }
-            else {
-                return lhs.relevance > rhs.relevance;
+            --chunk_left;
+            ++result.visited_postings;
+            if (query.excluded.Test(ordinal)) {
+                continue;
             }
+            const auto& document_data = documents_[ordinal];
+            if (document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                accumulator->Add(ordinal, term_freq * inverse_document_freq);
+            }
+        }
+        if (result.is_partial) {
+            break;
+        }
+    }
+
+    auto matched_documents = CollectDocuments(*accumulator, scratch.Resource());
+    KeepTopDocuments(matched_documents);
+    result.documents.assign(matched_documents.begin(), matched_documents.end());
+    return result;
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<Frequency>::FindTopDocuments(const std::string& raw_query,
+    DocumentPredicate document_predicate, const TermStatistics& statistics) const {
+
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    ParsedQuery query(scratch.Resource());
+    ParseQuery(raw_query, query, scratch.Resource());
+
+    const auto matched_documents = FindTopCandidates(ResolveQuery(query, &statistics, scratch.Resource()),
+        document_predicate, scratch.Resource());
+
+    return { matched_documents.begin(), matched_documents.end() };
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+const std::vector<Document>& BasicSearchServer<Frequency>::FindTopDocuments(QueryContext& context, const std::string& raw_query,
+    DocumentPredicate document_predicate) const {
+
+    QueryArena::Scope scratch(context.arena_);
+
+    ParseQuery(raw_query, context.query_, scratch.Resource());
+
+    const auto matched_documents = FindTopCandidates(ResolveQuery(context.query_, nullptr, scratch.Resource()),
+        document_predicate, scratch.Resource());
+
+    context.results_.assign(matched_documents.begin(), matched_documents.end());
+    return context.results_;
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::vector<std::vector<Document>> BasicSearchServer<Frequency>::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+    DocumentPredicate document_predicate) const {
+
+    // A plus word of one query in the group
+    struct TermUse {
+        const Postings* postings;
+        size_t slot;
+        Frequency inverse_document_freq;
+    };
+
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    std::pmr::vector<ResolvedQuery> queries(scratch.Resource());
+    queries.reserve(raw_queries.size());
+    for (const std::string& raw_query : raw_queries) {
+        ParsedQuery parsed_query(scratch.Resource());
+        ParseQuery(raw_query, parsed_query, scratch.Resource());
+        queries.push_back(ResolveQuery(parsed_query, nullptr, scratch.Resource()));
+    }
+    // Queries with the same longest posting list, the one most worth sharing, go to the same group
+    std::pmr::vector<size_t> order(queries.size(), scratch.Resource());
+    std::iota(order.begin(), order.end(), 0);
+    const auto longest_postings = [&queries](size_t query_index) {
+        const auto& plus_terms = queries[query_index].plus_terms;
+        return plus_terms.empty() ? nullptr : plus_terms.back().postings;
+    };
+    std::sort(order.begin(), order.end(), [&longest_postings](size_t lhs, size_t rhs) {
+        const Postings* lhs_postings = longest_postings(lhs);
+        const Postings* rhs_postings = longest_postings(rhs);
+        if (lhs_postings != rhs_postings) {
+            return std::less<const Postings*>()(lhs_postings, rhs_postings);
+        }
+        return lhs < rhs;
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    std::pmr::vector<TermUse> term_uses(scratch.Resource());
+    for (size_t group_begin = 0; group_begin < order.size(); group_begin += BATCH_GROUP_SIZE) {
+        const size_t group_size = std::min(BATCH_GROUP_SIZE, order.size() - group_begin);
+        const auto group_query = [&](size_t slot) -> const ResolvedQuery& {
+            return queries[order[group_begin + slot]];
+        };
+
+        term_uses.clear();
+        for (size_t slot = 0; slot < group_size; ++slot) {
+            for (const auto [postings, inverse_document_freq] : group_query(slot).plus_terms) {
+                term_uses.push_back({ postings, slot, inverse_document_freq });
+            }
+        }
+        // Uses of the same posting list become adjacent
+        std::sort(term_uses.begin(), term_uses.end(), [](const TermUse& lhs, const TermUse& rhs) {
+            return std::less<const Postings*>()(lhs.postings, rhs.postings)
+                || (lhs.postings == rhs.postings && lhs.slot < rhs.slot);
+            });
+
+        ThreadLocalBatchScoreAccumulator<Frequency> accumulator(documents_.size(), group_size);
+        for (auto term = term_uses.begin(); term != term_uses.end();) {
+            const auto term_end = std::find_if(term, term_uses.end(), [&term](const TermUse& use) {
+                return use.postings != term->postings;
+                });
+            for (const auto& [ordinal, term_freq] : *term->postings) {
+                const auto& document_data = documents_[ordinal];
+                if (!document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                    continue;
+                }
+                for (auto use = term; use != term_end; ++use) {
+                    if (!group_query(use->slot).excluded.Test(ordinal)) {
+                        accumulator->Add(ordinal, use->slot, term_freq * use->inverse_document_freq);
+                    }
+                }
+            }
+            term = term_end;
+        }
+
+        for (size_t slot = 0; slot < group_size; ++slot) {
+            // Only the top is kept while scanning, matched documents are not collected
+            std::vector<Document>& top_documents = results[order[group_begin + slot]];
+            top_documents.reserve(MAX_RESULT_DOCUMENT_COUNT + 1);
+            for (const int ordinal : accumulator->GetTouched()) {
+                if (!accumulator->Has(ordinal, slot)) {
+                    continue;
+                }
+                const auto& document_data = documents_[ordinal];
+                const Document document(document_data.id, accumulator->Get(ordinal, slot), document_data.rating);
+                if (top_documents.size() == MAX_RESULT_DOCUMENT_COUNT && !IsRankedBefore(document, top_documents.back())) {
+                    continue;
+                }
+                top_documents.insert(std::upper_bound(top_documents.begin(), top_documents.end(), document, IsRankedBefore),
+                    document);
+                if (top_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+                    top_documents.pop_back();
+                }
+            }
+        }
     }
+    return results;
+}
 
-    return matched_documents;
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::future<std::vector<Document>> BasicSearchServer<Frequency>::FindTopDocumentsAsync(ThreadPool& pool, const std::string& raw_query,
+    DocumentPredicate document_predicate) const {
+    return pool.Submit([this, &pool, raw_query, document_predicate] {
+        return FindTopDocumentsParallel(pool, raw_query, document_predicate);
+        });
 }
 
+template <typename Frequency>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+ResultPage BasicSearchServer<Frequency>::FindTopDocumentsAfter(const std::string& raw_query, DocumentPredicate document_predicate,
+    const std::optional<SearchCursor>& after, size_t page_size) const {
+
+    ResultPage page;
+    if (page_size == 0) {
+        return page;
+    }
+    std::optional<Document> last;
+    if (after) {
+        last = Document(after->id, after->relevance, after->rating);
+    }
+
+    // Max-heap by rank of the best documents after the cursor: the worst kept one is at the front.
+    // One more than the page is kept to tell whether a next page exists.
+    const size_t limit = page_size < std::numeric_limits<size_t>::max() ? page_size + 1 : page_size;
+    std::vector<Document>& best = page.documents;
+    ForEachMatchedDocument(raw_query, document_predicate, [&last, &best, limit](const Document& document) {
+        if (last && !IsRankedBefore(*last, document)) {
+            return;
+        }
+        if (best.size() < limit) {
+            best.push_back(document);
+            std::push_heap(best.begin(), best.end(), IsRankedBefore);
+        }
+        else if (IsRankedBefore(document, best.front())) {
+            std::pop_heap(best.begin(), best.end(), IsRankedBefore);
+            best.back() = document;
+            std::push_heap(best.begin(), best.end(), IsRankedBefore);
+        }
+        });
+    std::sort_heap(best.begin(), best.end(), IsRankedBefore);
+
+    if (best.size() > page_size) {
+        best.pop_back();
+        const Document& last_on_page = best.back();
+        page.next = SearchCursor{ last_on_page.relevance, last_on_page.rating, last_on_page.id };
+    }
+    return page;
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+ResultPager BasicSearchServer<Frequency>::FindDocumentPages(const std::string& raw_query, DocumentPredicate document_predicate) const {
+
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    ParsedQuery query(scratch.Resource());
+    ParseQuery(raw_query, query, scratch.Resource());
+
+    const auto matched_documents = FindAllDocuments(ResolveQuery(query, nullptr, scratch.Resource()),
+        document_predicate, scratch.Resource(), {});
+
+    return ResultPager({ matched_documents.begin(), matched_documents.end() });
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate, typename DocumentSink>
+void BasicSearchServer<Frequency>::ForEachMatchedDocument(const std::string& raw_query, DocumentPredicate document_predicate,
+    DocumentSink sink) const {
+
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    ParsedQuery parsed_query(scratch.Resource());
+    ParseQuery(raw_query, parsed_query, scratch.Resource());
+
+    // Minus words get cursors instead of the bitmap of excluded ordinals, which takes a bit per document
+    struct MinusCursor {
+        typename Postings::const_iterator position;
+        typename Postings::const_iterator end;
+    };
+    std::pmr::vector<MinusCursor> minus_cursors(scratch.Resource());
+    for (const std::string_view word : parsed_query.minus_words) {
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings != word_to_document_freqs_.end()) {
+            minus_cursors.push_back({ postings->second.begin(), postings->second.end() });
+        }
+    }
+    parsed_query.minus_words.clear();
+    const auto query = ResolveQuery(parsed_query, nullptr, scratch.Resource());
+
+    // Document-at-a-time: one cursor per posting list, always at the smallest unvisited ordinal
+    struct TermCursor {
+        typename Postings::const_iterator position;
+        typename Postings::const_iterator end;
+        Frequency inverse_document_freq;
+    };
+    std::pmr::vector<TermCursor> plus_cursors(scratch.Resource());
+    for (const auto [postings, inverse_document_freq] : query.plus_terms) {
+        plus_cursors.push_back({ postings->begin(), postings->end(), inverse_document_freq });
+    }
+
+    while (true) {
+        int ordinal = std::numeric_limits<int>::max();
+        for (const TermCursor& cursor : plus_cursors) {
+            if (cursor.position != cursor.end) {
+                ordinal = std::min(ordinal, cursor.position->first);
+            }
+        }
+        if (ordinal == std::numeric_limits<int>::max()) {
+            return;
+        }
+
+        Frequency relevance = 0;
+        for (TermCursor& cursor : plus_cursors) {
+            if (cursor.position != cursor.end && cursor.position->first == ordinal) {
+                relevance += cursor.position->second * cursor.inverse_document_freq;
+                ++cursor.position;
+            }
+        }
+
+        // Visited ordinals only grow, so minus cursors move forward only
+        bool is_excluded = false;
+        for (MinusCursor& cursor : minus_cursors) {
+            while (cursor.position != cursor.end && cursor.position->first < ordinal) {
+                ++cursor.position;
+            }
+            is_excluded = is_excluded || (cursor.position != cursor.end && cursor.position->first == ordinal);
+        }
+        if (is_excluded) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+
+        const auto& document_data = documents_[ordinal];
+        if (!document_predicate(document_data.id, document_data.status, document_data.rating)) {
+            continue;
+        }
+        const Document document(document_data.id, relevance, document_data.rating);
+        if constexpr (std::is_same_v<std::invoke_result_t<DocumentSink&, const Document&>, bool>) {
+            if (!sink(document)) {
+                return;
             }
         }
+        else {
+            sink(document);
+        }
+    }
+}
+
+template <typename Frequency>
+template <typename DocumentSink>
+void BasicSearchServer<Frequency>::ForEachMatchedDocument(const std::string& raw_query, DocumentStatus status, DocumentSink sink) const {
+    ForEachMatchedDocument(raw_query, StatusEquals{ status }, std::move(sink));
+}
+
+template <typename Frequency>
+template <typename DocumentSink>
+void BasicSearchServer<Frequency>::ForEachMatchedDocument(const std::string& raw_query, DocumentSink sink) const {
+    ForEachMatchedDocument(raw_query, DocumentStatus::ACTUAL, std::move(sink));
+}
+
+template <typename Frequency>
+template <typename Documents>
+void BasicSearchServer<Frequency>::KeepTopDocuments(Documents& documents) {
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        std::partial_sort(documents.begin(), documents.begin() + MAX_RESULT_DOCUMENT_COUNT, documents.end(), IsRankedBefore);
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    else {
+        std::sort(documents.begin(), documents.end(), IsRankedBefore);
+    }
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::pmr::vector<Document> BasicSearchServer<Frequency>::FindTopCandidates(const ResolvedQuery& query, DocumentPredicate document_predicate,
+    std::pmr::memory_resource* resource, OrdinalRange range) const {
+
+    if (!impact_orders_.empty() && range.begin == 0 && range.end == std::numeric_limits<int>::max()) {
+        if (auto top_documents = FindTopByImpact(query, document_predicate, resource)) {
+            return std::move(*top_documents);
+        }
     }
 
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    auto matched_documents = FindAllDocuments(query, document_predicate, resource, range);
+
+    KeepTopDocuments(matched_documents);
+
+    return matched_documents;
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::optional<std::pmr::vector<Document>> BasicSearchServer<Frequency>::FindTopByImpact(const ResolvedQuery& query,
+    DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const {
+
+    // Read position in the impact order of a plus word, merging its two sorted runs
+    struct Cursor {
+        const ImpactOrder* order;
+        Frequency inverse_document_freq;
+        size_t position = 0;
+        size_t added_position = 0;
+
+        // Next unread posting; nullptr when the order is read to the end
+        const Posting* Peek() {
+            const auto& postings = order->postings;
+            while (position < postings.size() && postings[position].first < 0) {
+                ++position;
+            }
+            const Posting* sorted = position < postings.size() ? &postings[position] : nullptr;
+            const Posting* added = added_position < order->added.size() ? &order->added[added_position] : nullptr;
+            if (sorted && added) {
+                return IsImpactOrdered(*added, *sorted) ? added : sorted;
+            }
+            return sorted ? sorted : added;
+        }
+
+        // Moves past the posting Peek returned
+        void Advance(const Posting* posting) {
+            if (added_position < order->added.size() && posting == &order->added[added_position]) {
+                ++added_position;
+            }
+            else {
+                ++position;
+            }
+        }
+    };
+
+    std::pmr::vector<Cursor> cursors(resource);
+    std::pmr::vector<const Postings*> unordered_terms(resource);
+    size_t ordered_posting_count = 0;
+    for (const auto [postings, inverse_document_freq] : query.plus_terms) {
+        const auto order = impact_orders_.find(postings);
+        if (order == impact_orders_.end()) {
+            unordered_terms.push_back(postings);
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        cursors.push_back({ &order->second, inverse_document_freq });
+        ordered_posting_count += order->second.postings.size() + order->second.added.size();
+    }
+    if (cursors.empty()) {
+        return std::nullopt;
+    }
+
+    // Relevance is summed in plus word order, as the accumulator does, so it comes out the same
+    const bool is_single_term = query.plus_terms.size() == 1;
+    const auto score = [&](int ordinal, Frequency term_freq) {
+        if (is_single_term) {
+            return term_freq * query.plus_terms[0].inverse_document_freq;
+        }
+        Frequency relevance = 0;
+        for (const auto [postings, inverse_document_freq] : query.plus_terms) {
+            const auto posting = postings->find(ordinal);
+            if (posting != postings->end()) {
+                relevance += posting->second * inverse_document_freq;
+            }
+        }
+        return relevance;
+    };
+
+    std::pmr::vector<Document> documents(resource);
+    // Relevance of the MAX_RESULT_DOCUMENT_COUNT best documents found, the least on top
+    std::pmr::vector<double> best_relevances(resource);
+    // A document reached through several words is scored once
+    std::pmr::unordered_set<int> scored_ordinals(resource);
+    const auto add_document = [&](int ordinal, Frequency term_freq) {
+        if ((!is_single_term && !scored_ordinals.insert(ordinal).second) || query.excluded.Test(ordinal)) {
+            return;
+        }
+        const auto& document_data = documents_[ordinal];
+        if (!document_predicate(document_data.id, document_data.status, document_data.rating)) {
+            return;
+        }
+        const double relevance = score(ordinal, term_freq);
+        documents.push_back({ document_data.id, relevance, document_data.rating });
+        if (best_relevances.size() < MAX_RESULT_DOCUMENT_COUNT) {
+            best_relevances.push_back(relevance);
+            std::push_heap(best_relevances.begin(), best_relevances.end(), std::greater<>());
+        }
+        else if (relevance > best_relevances.front()) {
+            std::pop_heap(best_relevances.begin(), best_relevances.end(), std::greater<>());
+            best_relevances.back() = relevance;
+            std::push_heap(best_relevances.begin(), best_relevances.end(), std::greater<>());
+        }
+    };
+    // Unread documents have relevance at most bound; they can't rank before the top
+    // once its least relevant document is ahead of the bound by more than the tie accuracy
+    const auto is_top_final = [&documents](double bound) {
+        if (documents.size() < MAX_RESULT_DOCUMENT_COUNT) {
+            return false;
+        }
+        KeepTopDocuments(documents);
+        const double min_relevance = std::min_element(documents.begin(), documents.end(),
+            [](const Document& lhs, const Document& rhs) {
+                return lhs.relevance < rhs.relevance;
+            })->relevance;
+        return min_relevance - bound >= COMPARISON_ACCURACY_FOR_DOUBLE;
+    };
+
+    // One word with a status filter: the status top of the word is often enough
+    if constexpr (IsIndexPredicate<DocumentPredicate>::value) {
+        DocumentFilter filter(resource);
+        AddToFilter(document_predicate, filter);
+        if (is_single_term && filter.status) {
+            const auto& top = cursors[0].order->status_tops[static_cast<size_t>(*filter.status)];
+            for (const auto& [ordinal, term_freq] : top.postings) {
+                add_document(ordinal, term_freq);
+            }
+            if (top.is_complete) {
+                KeepTopDocuments(documents);
+                return documents;
+            }
+            // Documents of the status left out of the top have at most the frequency of its last one
+            if (!top.postings.empty()
+                && is_top_final(top.postings.back().second * cursors[0].inverse_document_freq)) {
+                return documents;
+            }
+            documents.clear();
+            best_relevances.clear();
         }
     }
 
+    // Words without an impact order are scored whole, so they add nothing to unread documents
+    for (const Postings* postings : unordered_terms) {
+        for (const auto& [ordinal, term_freq] : *postings) {
+            add_document(ordinal, term_freq);
+        }
+    }
+
+    const size_t max_read_count = ordered_posting_count / IMPACT_SCAN_LIMIT_DIVISOR;
+    size_t read_count = 0;
+    while (true) {
+        // Summed in plus word order too, so it bounds the relevance of an unread document exactly
+        Frequency bound = 0;
+        bool is_exhausted = true;
+        for (Cursor& cursor : cursors) {
+            if (const Posting* posting = cursor.Peek()) {
+                bound += posting->second * cursor.inverse_document_freq;
+                is_exhausted = false;
+            }
+        }
+        if (is_exhausted) {
+            break;
+        }
+        // The cheap check on the best relevances comes first; the top is sorted only when it may be final
+        if (best_relevances.size() == MAX_RESULT_DOCUMENT_COUNT
+            && best_relevances.front() - bound >= 2 * COMPARISON_ACCURACY_FOR_DOUBLE && is_top_final(bound)) {
+            return documents;
+        }
+        if (read_count >= max_read_count) {
+            return std::nullopt;
+        }
+        for (Cursor& cursor : cursors) {
+            if (const Posting* posting = cursor.Peek()) {
+                cursor.Advance(posting);
+                add_document(posting->first, posting->second);
+                ++read_count;
+            }
+        }
+    }
+
+    KeepTopDocuments(documents);
+    return documents;
+}
+
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<Frequency>::FindTopDocumentsParallel(ThreadPool& pool, const std::string& raw_query,
+    DocumentPredicate document_predicate) const {
+
+    QueryArena::Scope scratch(ThreadLocalQueryArena());
+
+    ParsedQuery parsed_query(scratch.Resource());
+    ParseQuery(raw_query, parsed_query, scratch.Resource());
+    const auto query = ResolveQuery(parsed_query, nullptr, scratch.Resource());
+
+    // Reading a prefix of the impact orders beats splitting the full scan
+    if (!impact_orders_.empty()) {
+        if (const auto top_documents = FindTopByImpact(query, document_predicate, scratch.Resource())) {
+            return { top_documents->begin(), top_documents->end() };
+        }
+    }
+
+    size_t posting_count = 0;
+    for (const auto& term : query.plus_terms) {
+        posting_count += term.postings->size();
+    }
+    const size_t task_count = std::min(pool.GetThreadCount(), posting_count / MIN_POSTINGS_PER_TASK);
+    if (task_count <= 1) {
+        const auto matched_documents = FindTopCandidates(query, document_predicate, scratch.Resource());
+        return { matched_documents.begin(), matched_documents.end() };
+    }
+
+    // Ranges are disjoint, so every sub-task owns its accumulator and only the top of each is merged
+    const int ordinal_count = static_cast<int>(documents_.size());
+    std::vector<std::vector<Document>> partial_results(task_count);
+    pool.ParallelFor(task_count, [&](size_t task_index) {
+        QueryArena::Scope task_scratch(ThreadLocalQueryArena());
+        const OrdinalRange range{
+            static_cast<int>(ordinal_count * task_index / task_count),
+            static_cast<int>(ordinal_count * (task_index + 1) / task_count) };
+        const auto matched_documents = FindTopCandidates(query, document_predicate, task_scratch.Resource(), range);
+        partial_results[task_index].assign(matched_documents.begin(), matched_documents.end());
+        });
+
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+    for (const auto& documents : partial_results) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
     }
-    return matched_documents;    
+    KeepTopDocuments(matched_documents);
+    return matched_documents;
+}
 
-}
\ No newline at end of file
+template <typename Frequency>
+template <typename DocumentPredicate>
+std::pmr::vector<Document> BasicSearchServer<Frequency>::FindAllDocuments(const ResolvedQuery& query, DocumentPredicate document_predicate,
+    std::pmr::memory_resource* resource, OrdinalRange range) const {
+    if constexpr (IsIndexPredicate<DocumentPredicate>::value) {
+        DocumentFilter filter(resource);
+        AddToFilter(document_predicate, filter);
+        return FindAllDocuments(query, filter, resource, range);
+    }
+    else {
+        ThreadLocalScoreAccumulator<Frequency> accumulator(documents_.size());
+        for (const auto [postings, inverse_document_freq] : query.plus_terms) {
+            const auto range_end = postings->lower_bound(range.end);
+            for (auto posting = postings->lower_bound(range.begin); posting != range_end; ++posting) {
+                const auto [ordinal, term_freq] = *posting;
+                if (query.excluded.Test(ordinal)) {
+                    continue;
+                }
+                const auto& document_data = documents_[ordinal];
+                if (document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                    accumulator->Add(ordinal, term_freq * inverse_document_freq);
+                }
+            }
+        }
+
+        return CollectDocuments(*accumulator, resource);
+    }
+}
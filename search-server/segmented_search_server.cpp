@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "segmented_search_server.h"
+#include "string_processing.h"
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string& stop_words_text, SegmentedSearchServerOptions options)
+    : stop_words_(SplitIntoWords(stop_words_text))
+    , options_(options)
+    , snapshot_(std::make_shared<const Snapshot>())
+    , write_buffer_(std::make_unique<SearchServer>(stop_words_)) {
+    // With no segment allowed every merge would leave one too many, and the merge thread would never rest
+    if (options_.max_segment_count == 0) {
+        throw std::invalid_argument("max_segment_count must be positive"s);
+    }
+    merge_thread_ = std::thread([this] {
+        MergeLoop();
+        });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        std::lock_guard guard(write_mutex_);
+        stopping_ = true;
+    }
+    merge_wakeup_.notify_all();
+    merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+    const std::vector<int>& ratings) {
+    std::lock_guard guard(write_mutex_);
+    if (document_segments_.count(document_id) > 0) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    write_buffer_->AddDocument(document_id, document, status, ratings);
+    document_segments_.emplace(document_id, WRITE_BUFFER_ID);
+    if (static_cast<size_t>(write_buffer_->GetDocumentCount()) >= options_.max_buffered_documents) {
+        RefreshLocked();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard guard(write_mutex_);
+    const auto location = document_segments_.find(document_id);
+    if (location == document_segments_.end()) {
+        return;
+    }
+    const uint64_t segment_id = location->second;
+    document_segments_.erase(location);
+    if (segment_id == WRITE_BUFFER_ID) {
+        write_buffer_->RemoveDocument(document_id);
+        return;
+    }
+
+    auto segments = LoadSnapshot()->segments;
+    for (Segment& segment : segments) {
+        if (segment.id == segment_id) {
+            auto removed_ids = std::make_shared<std::set<int>>(*segment.removed_ids);
+            removed_ids->insert(document_id);
+            segment.removed_ids = std::move(removed_ids);
+        }
+    }
+    Publish(std::move(segments));
+}
+
+void SegmentedSearchServer::Refresh() {
+    std::lock_guard guard(write_mutex_);
+    RefreshLocked();
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, StatusEquals{ status });
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> SegmentedSearchServer::MatchDocument(const std::string& raw_query,
+    int document_id) const {
+    const auto snapshot = LoadSnapshot();
+    for (const Segment& segment : snapshot->segments) {
+        if (segment.index->HasDocument(document_id) && segment.removed_ids->count(document_id) == 0) {
+            return segment.index->MatchDocument(raw_query, document_id);
+        }
+    }
+    throw std::out_of_range("Document "s + std::to_string(document_id) + " is not found"s);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    return LoadSnapshot()->document_count;
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    return LoadSnapshot()->segments.size();
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+    std::unique_lock lock(write_mutex_);
+    merge_done_.wait(lock, [this] {
+        return !merge_running_ && !NeedsMerge(*LoadSnapshot());
+        });
+}
+
+int SegmentedSearchServer::Segment::GetDocumentCount() const {
+    return index->GetDocumentCount() - static_cast<int>(removed_ids->size());
+}
+
+std::shared_ptr<const SegmentedSearchServer::Snapshot> SegmentedSearchServer::LoadSnapshot() const {
+    return snapshot_.load();
+}
+
+void SegmentedSearchServer::Publish(std::vector<Segment> segments) {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->segments = std::move(segments);
+    for (const Segment& segment : snapshot->segments) {
+        snapshot->document_count += segment.GetDocumentCount();
+    }
+    const bool needs_merge = NeedsMerge(*snapshot);
+    snapshot_.store(std::move(snapshot));
+    if (needs_merge) {
+        merge_wakeup_.notify_one();
+    }
+}
+
+void SegmentedSearchServer::RefreshLocked() {
+    if (write_buffer_->GetDocumentCount() == 0) {
+        return;
+    }
+    const uint64_t segment_id = next_segment_id_++;
+    for (const int document_id : *write_buffer_) {
+        document_segments_[document_id] = segment_id;
+    }
+    auto segments = LoadSnapshot()->segments;
+    segments.push_back({ segment_id, std::shared_ptr<const SearchServer>(std::move(write_buffer_)),
+        std::make_shared<const std::set<int>>() });
+    write_buffer_ = std::make_unique<SearchServer>(stop_words_);
+    Publish(std::move(segments));
+}
+
+bool SegmentedSearchServer::NeedsMerge(const Snapshot& snapshot) const {
+    if (snapshot.segments.size() > options_.max_segment_count) {
+        return true;
+    }
+    // Segments that are mostly tombstones are rewritten
+    return std::any_of(snapshot.segments.begin(), snapshot.segments.end(), [](const Segment& segment) {
+        return segment.removed_ids->size() * 2 > static_cast<size_t>(segment.index->GetDocumentCount());
+        });
+}
+
+void SegmentedSearchServer::MergeLoop() {
+    std::unique_lock lock(write_mutex_);
+    while (!stopping_) {
+        const auto wake_up = [this] {
+            return stopping_ || NeedsMerge(*LoadSnapshot());
+        };
+        if (options_.refresh_interval.count() > 0) {
+            merge_wakeup_.wait_for(lock, options_.refresh_interval, wake_up);
+            RefreshLocked();
+        }
+        else {
+            merge_wakeup_.wait(lock, wake_up);
+        }
+        if (stopping_ || !NeedsMerge(*LoadSnapshot())) {
+            continue;
+        }
+        merge_running_ = true;
+        lock.unlock();
+        MergeSegments();
+        lock.lock();
+        merge_running_ = false;
+        merge_done_.notify_all();
+    }
+}
+
+void SegmentedSearchServer::MergeSegments() {
+    // Merge the smallest segments into one, so that the count drops to half of the limit,
+    // together with every segment that is mostly tombstones
+    auto segments = LoadSnapshot()->segments;
+    std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs) {
+        return lhs.GetDocumentCount() < rhs.GetDocumentCount();
+        });
+    size_t merged_count = 0;
+    if (segments.size() > options_.max_segment_count) {
+        merged_count = segments.size() - options_.max_segment_count / 2;
+    }
+    std::vector<Segment> merged(segments.begin(), segments.begin() + merged_count);
+    for (auto segment = segments.begin() + merged_count; segment != segments.end(); ++segment) {
+        if (segment->removed_ids->size() * 2 > static_cast<size_t>(segment->index->GetDocumentCount())) {
+            merged.push_back(*segment);
+        }
+    }
+
+    // Built without the lock: readers and writers keep going on the current snapshot
+    auto merged_index = std::make_shared<SearchServer>(stop_words_);
+    for (const Segment& segment : merged) {
+        for (const int document_id : *segment.index) {
+            if (segment.removed_ids->count(document_id) == 0) {
+                merged_index->CopyDocumentFrom(*segment.index, document_id);
+            }
+        }
+    }
+
+    std::lock_guard guard(write_mutex_);
+    const uint64_t merged_id = next_segment_id_++;
+    std::vector<Segment> new_segments;
+    auto removed_during_merge = std::make_shared<std::set<int>>();
+    for (const Segment& segment : LoadSnapshot()->segments) {
+        const auto source = std::find_if(merged.begin(), merged.end(), [&segment](const Segment& merged_segment) {
+            return merged_segment.id == segment.id;
+            });
+        if (source == merged.end()) {
+            new_segments.push_back(segment);
+            continue;
+        }
+        // Documents removed while the merge was running stay removed in the merged segment
+        for (const int document_id : *segment.removed_ids) {
+            if (source->removed_ids->count(document_id) == 0) {
+                removed_during_merge->insert(document_id);
+            }
+        }
+    }
+    // Documents removed (and maybe added again) during the merge already point elsewhere
+    for (auto& [document_id, segment_id] : document_segments_) {
+        const bool was_merged = std::any_of(merged.begin(), merged.end(), [segment_id = segment_id](const Segment& segment) {
+            return segment.id == segment_id;
+            });
+        if (was_merged) {
+            segment_id = merged_id;
+        }
+    }
+    if (merged_index->GetDocumentCount() > 0) {
+        new_segments.push_back({ merged_id, std::move(merged_index), std::move(removed_during_merge) });
+    }
+    Publish(std::move(new_segments));
+}
+
+TermStatistics SegmentedSearchServer::GetTermStatistics(const Snapshot& snapshot, const std::string& raw_query) {
+    TermStatistics statistics;
+    for (const Segment& segment : snapshot.segments) {
+        TermStatistics segment_statistics = segment.index->GetTermStatistics(raw_query);
+        segment_statistics.document_count -= static_cast<int>(segment.removed_ids->size());
+        for (const int document_id : *segment.removed_ids) {
+            const auto& word_freqs = segment.index->GetIndexedWordFrequencies(document_id);
+            for (auto& [word, document_freq] : segment_statistics.document_freqs) {
+                if (word_freqs.count(std::string_view(word)) > 0) {
+                    --document_freq;
+                }
+            }
+        }
+        statistics.Merge(segment_statistics);
+    }
+    return statistics;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "term_statistics.h"
+
+struct SegmentedSearchServerOptions {
+    // The write buffer is published as a segment when it reaches this size
+    size_t max_buffered_documents = 1000;
+    // The background thread also publishes the buffer this often; zero disables it
+    std::chrono::milliseconds refresh_interval{ 1000 };
+    // More segments than this are merged in the background; must be positive
+    size_t max_segment_count = 8;
+};
+
+// Search index that serves queries while it is being updated.
+// Documents live in immutable segments, each an ordinary SearchServer. Additions go to a write
+// buffer that becomes a new segment on Refresh(); removals of published documents are recorded as
+// tombstones. Every change publishes a new snapshot (the segment list with tombstones), which is
+// swapped atomically: readers take the current snapshot and never wait for writers, and a snapshot
+// stays consistent for the whole query. A background thread merges small segments and drops
+// removed documents. Relevance is computed over all segments, so it matches a single SearchServer.
+class SegmentedSearchServer {
+public:
+    explicit SegmentedSearchServer(const std::string& stop_words_text, SegmentedSearchServerOptions options = {});
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    ~SegmentedSearchServer();
+
+    // Visible to queries after the next refresh
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Visible to queries immediately
+    void RemoveDocument(int document_id);
+
+    // Publishes the write buffer as a new segment
+    void Refresh();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+
+    // Number of published documents
+    int GetDocumentCount() const;
+
+    size_t GetSegmentCount() const;
+
+    // Blocks until no merge is pending
+    void WaitForMerges();
+
+private:
+    struct Segment {
+        uint64_t id;
+        std::shared_ptr<const SearchServer> index;
+        std::shared_ptr<const std::set<int>> removed_ids;
+
+        int GetDocumentCount() const;
+    };
+
+    struct Snapshot {
+        std::vector<Segment> segments;
+        int document_count = 0;
+    };
+
+    inline static constexpr uint64_t WRITE_BUFFER_ID = 0;
+
+    const std::vector<std::string> stop_words_;
+    const SegmentedSearchServerOptions options_;
+
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+
+    // Writers, the merge thread and publishing are serialized by this mutex
+    std::mutex write_mutex_;
+    std::unique_ptr<SearchServer> write_buffer_;
+    // Where every document lives: a segment id or WRITE_BUFFER_ID
+    std::map<int, uint64_t> document_segments_;
+    uint64_t next_segment_id_ = WRITE_BUFFER_ID + 1;
+
+    std::condition_variable merge_wakeup_;
+    std::condition_variable merge_done_;
+    bool merge_running_ = false;
+    bool stopping_ = false;
+    std::thread merge_thread_;
+
+    std::shared_ptr<const Snapshot> LoadSnapshot() const;
+
+    // Expects write_mutex_ to be held
+    void Publish(std::vector<Segment> segments);
+
+    void RefreshLocked();
+
+    bool NeedsMerge(const Snapshot& snapshot) const;
+
+    void MergeLoop();
+
+    void MergeSegments();
+
+    // Statistics of the snapshot without removed documents
+    static TermStatistics GetTermStatistics(const Snapshot& snapshot, const std::string& raw_query);
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string& raw_query,
+    DocumentPredicate document_predicate) const {
+    const auto snapshot = LoadSnapshot();
+    const TermStatistics statistics = GetTermStatistics(*snapshot, raw_query);
+
+    std::vector<Document> matched_documents;
+    for (const Segment& segment : snapshot->segments) {
+        std::vector<Document> segment_documents;
+        if (segment.removed_ids->empty()) {
+            segment_documents = segment.index->FindTopDocuments(raw_query, document_predicate, statistics);
+        }
+        else {
+            const auto& removed_ids = *segment.removed_ids;
+            segment_documents = segment.index->FindTopDocuments(raw_query,
+                [&removed_ids, &document_predicate](int document_id, DocumentStatus status, int rating) {
+                    return removed_ids.count(document_id) == 0 && document_predicate(document_id, status, rating);
+                },
+                statistics);
+        }
+        matched_documents.insert(matched_documents.end(), segment_documents.begin(), segment_documents.end());
+    }
+    SearchServer::KeepTopDocuments(matched_documents);
+    return matched_documents;
+}
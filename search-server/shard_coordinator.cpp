@@ -0,0 +1,165 @@
+#include <stdexcept>
+
+#include "search_server.h"
+#include "shard_coordinator.h"
+#include "shard_protocol.h"
+
+ShardCoordinator::ShardCoordinator(const std::vector<Endpoint>& shards, ShardCoordinatorOptions options)
+    : options_(options)
+    , pool_(shards.size()) {
+    if (shards.empty()) {
+        throw std::invalid_argument("Coordinator needs at least one shard"s);
+    }
+    for (const Endpoint& endpoint : shards) {
+        shards_.push_back(std::make_unique<ShardConnection>());
+        shards_.back()->endpoint = endpoint;
+    }
+}
+
+void ShardCoordinator::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+    const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    MessageWriter request;
+    request.WriteByte(static_cast<uint8_t>(ShardRequest::ADD_DOCUMENT));
+    request.WriteInt(document_id);
+    request.WriteByte(static_cast<uint8_t>(status));
+    request.WriteUint(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        request.WriteInt(rating);
+    }
+    request.WriteString(document);
+    Call(GetShard(document_id), request.GetData(), SocketClock::now() + options_.write_timeout);
+}
+
+void ShardCoordinator::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    MessageWriter request;
+    request.WriteByte(static_cast<uint8_t>(ShardRequest::REMOVE_DOCUMENT));
+    request.WriteInt(document_id);
+    Call(GetShard(document_id), request.GetData(), SocketClock::now() + options_.write_timeout);
+}
+
+GatheredDocuments ShardCoordinator::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
+    const auto deadline = SocketClock::now() + options_.shard_timeout;
+
+    MessageWriter statistics_request;
+    statistics_request.WriteByte(static_cast<uint8_t>(ShardRequest::GET_TERM_STATISTICS));
+    statistics_request.WriteString(raw_query);
+    std::vector<std::optional<TermStatistics>> shard_statistics(shards_.size());
+    pool_.ParallelFor(shards_.size(), [&](size_t shard_index) {
+        try {
+            const std::string response = Call(*shards_[shard_index], statistics_request.GetData(), deadline);
+            shard_statistics[shard_index] = MessageReader(response).ReadStatistics();
+        }
+        catch (const SocketError&) {
+        }
+        });
+    TermStatistics statistics;
+    for (const auto& shard : shard_statistics) {
+        if (shard) {
+            statistics.Merge(*shard);
+        }
+    }
+
+    MessageWriter find_request;
+    find_request.WriteByte(static_cast<uint8_t>(ShardRequest::FIND_TOP_DOCUMENTS));
+    find_request.WriteString(raw_query);
+    find_request.WriteByte(static_cast<uint8_t>(status));
+    find_request.WriteStatistics(statistics);
+    std::vector<std::optional<std::vector<Document>>> shard_documents(shards_.size());
+    pool_.ParallelFor(shards_.size(), [&](size_t shard_index) {
+        if (!shard_statistics[shard_index]) {
+            return;
+        }
+        try {
+            const std::string response = Call(*shards_[shard_index], find_request.GetData(), deadline);
+            shard_documents[shard_index] = MessageReader(response).ReadDocuments();
+        }
+        catch (const SocketError&) {
+        }
+        });
+
+    GatheredDocuments result;
+    for (const auto& documents : shard_documents) {
+        if (!documents) {
+            ++result.missed_shard_count;
+            continue;
+        }
+        result.documents.insert(result.documents.end(), documents->begin(), documents->end());
+    }
+    SearchServer::KeepTopDocuments(result.documents);
+    return result;
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardCoordinator::MatchDocument(const std::string& raw_query,
+    int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range("Invalid document_id"s);
+    }
+    MessageWriter request;
+    request.WriteByte(static_cast<uint8_t>(ShardRequest::MATCH_DOCUMENT));
+    request.WriteString(raw_query);
+    request.WriteInt(document_id);
+    const std::string response = Call(GetShard(document_id), request.GetData(),
+        SocketClock::now() + options_.shard_timeout);
+
+    MessageReader reader(response);
+    std::vector<std::string> words;
+    for (uint32_t word_count = reader.ReadUint(); word_count > 0; --word_count) {
+        words.push_back(reader.ReadString());
+    }
+    return { words, reader.ReadStatus() };
+}
+
+size_t ShardCoordinator::GetShardCount() const {
+    return shards_.size();
+}
+
+std::string ShardCoordinator::Call(ShardConnection& shard, const std::string& request,
+    SocketClock::time_point deadline) const {
+    std::string response;
+    {
+        // A query that ran out of time behind another request leaves the connection alone
+        std::unique_lock guard(shard.mutex, std::defer_lock);
+        if (deadline == NO_DEADLINE) {
+            guard.lock();
+        }
+        else if (!guard.try_lock_until(deadline) || SocketClock::now() >= deadline) {
+            throw SocketError(shard.endpoint.ToString() + ": deadline passed before the request was sent"s);
+        }
+        if (!shard.socket.IsOpen()) {
+            shard.socket = Connect(shard.endpoint, deadline);
+        }
+        try {
+            SendFrame(shard.socket, request, deadline);
+            response = ReceiveFrame(shard.socket, deadline);
+        }
+        catch (const SocketError&) {
+            // The stream may hold a half-sent request or a half-read response, so the connection can't be reused
+            shard.socket.Close();
+            throw;
+        }
+    }
+
+    MessageReader reader(response);
+    const auto status = static_cast<ShardResponse>(reader.ReadByte());
+    if (status == ShardResponse::OK) {
+        return response.substr(1);
+    }
+    const std::string message = reader.ReadString();
+    if (status == ShardResponse::INVALID_ARGUMENT) {
+        throw std::invalid_argument(message);
+    }
+    if (status == ShardResponse::OUT_OF_RANGE) {
+        throw std::out_of_range(message);
+    }
+    throw std::runtime_error(shard.endpoint.ToString() + ": "s + message);
+}
+
+ShardCoordinator::ShardConnection& ShardCoordinator::GetShard(int document_id) const {
+    return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "socket_io.h"
+#include "term_statistics.h"
+#include "thread_pool.h"
+
+struct ShardCoordinatorOptions {
+    // Time a shard has to answer one query (both phases); late shards are left out of the result
+    std::chrono::milliseconds shard_timeout{ 200 };
+    // Time a shard has to apply one update; a late update fails with SocketError
+    // and may or may not have been applied
+    std::chrono::milliseconds write_timeout{ 5000 };
+};
+
+struct GatheredDocuments {
+    std::vector<Document> documents;
+    // Shards that did not answer in time; their documents are missing from the result
+    size_t missed_shard_count = 0;
+};
+
+// Spreads a corpus across ShardServer processes, by document_id modulo the number of shards.
+// A query runs in two phases: term statistics are gathered from every shard and summed, then
+// the query is broadcast together with the global statistics, so relevance matches a single
+// SearchServer, and the shards' top documents are merged.
+class ShardCoordinator {
+public:
+    explicit ShardCoordinator(const std::vector<Endpoint>& shards, ShardCoordinatorOptions options = {});
+
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    GatheredDocuments FindTopDocuments(const std::string& raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+
+    size_t GetShardCount() const;
+
+private:
+    // One request at a time per connection; it is reopened lazily after a failure
+    struct ShardConnection {
+        Endpoint endpoint;
+        std::timed_mutex mutex;
+        Socket socket;
+    };
+
+    ShardCoordinatorOptions options_;
+    std::vector<std::unique_ptr<ShardConnection>> shards_;
+    mutable ThreadPool pool_;
+
+    // Returns the response payload after the status byte; shard errors are rethrown
+    // as std::invalid_argument, std::out_of_range or std::runtime_error. Waiting for the
+    // connection counts against the deadline too.
+    std::string Call(ShardConnection& shard, const std::string& request, SocketClock::time_point deadline) const;
+
+    ShardConnection& GetShard(int document_id) const;
+};
@@ -0,0 +1,145 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "shard_protocol.h"
+
+using namespace std::string_literals;
+
+void MessageWriter::WriteByte(uint8_t value) {
+    data_.push_back(static_cast<char>(value));
+}
+
+void MessageWriter::WriteInt(int32_t value) {
+    WriteUint(static_cast<uint32_t>(value));
+}
+
+void MessageWriter::WriteUint(uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        data_.push_back(static_cast<char>(value >> shift));
+    }
+}
+
+void MessageWriter::WriteUint64(uint64_t value) {
+    WriteUint(static_cast<uint32_t>(value));
+    WriteUint(static_cast<uint32_t>(value >> 32));
+}
+
+void MessageWriter::WriteDouble(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteUint(static_cast<uint32_t>(bits));
+    WriteUint(static_cast<uint32_t>(bits >> 32));
+}
+
+void MessageWriter::WriteString(std::string_view value) {
+    WriteUint(static_cast<uint32_t>(value.size()));
+    data_.append(value);
+}
+
+void MessageWriter::WriteStatistics(const TermStatistics& statistics) {
+    WriteInt(statistics.document_count);
+    WriteUint(static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        WriteString(word);
+        WriteInt(document_freq);
+    }
+}
+
+void MessageWriter::WriteDocuments(const std::vector<Document>& documents) {
+    WriteUint(static_cast<uint32_t>(documents.size()));
+    for (const Document& document : documents) {
+        WriteInt(document.id);
+        WriteDouble(document.relevance);
+        WriteInt(document.rating);
+    }
+}
+
+const std::string& MessageWriter::GetData() const {
+    return data_;
+}
+
+MessageReader::MessageReader(std::string_view data)
+    : data_(data) {
+}
+
+uint8_t MessageReader::ReadByte() {
+    return static_cast<uint8_t>(Take(1)[0]);
+}
+
+int32_t MessageReader::ReadInt() {
+    return static_cast<int32_t>(ReadUint());
+}
+
+uint32_t MessageReader::ReadUint() {
+    const std::string_view bytes = Take(4);
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = value << 8 | static_cast<uint8_t>(bytes[i]);
+    }
+    return value;
+}
+
+uint64_t MessageReader::ReadUint64() {
+    const uint64_t low = ReadUint();
+    return low | static_cast<uint64_t>(ReadUint()) << 32;
+}
+
+double MessageReader::ReadDouble() {
+    const uint64_t low = ReadUint();
+    const uint64_t bits = low | static_cast<uint64_t>(ReadUint()) << 32;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+DocumentStatus MessageReader::ReadStatus() {
+    const uint8_t status = ReadByte();
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        throw std::invalid_argument("Invalid document status "s + std::to_string(status));
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+std::string MessageReader::ReadString() {
+    return std::string(ReadStringView());
+}
+
+std::string_view MessageReader::ReadStringView() {
+    const uint32_t size = ReadUint();
+    return Take(size);
+}
+
+TermStatistics MessageReader::ReadStatistics() {
+    TermStatistics statistics;
+    statistics.document_count = ReadInt();
+    const uint32_t word_count = ReadUint();
+    for (uint32_t i = 0; i < word_count; ++i) {
+        std::string word = ReadString();
+        statistics.document_freqs.emplace(std::move(word), ReadInt());
+    }
+    return statistics;
+}
+
+std::vector<Document> MessageReader::ReadDocuments() {
+    const uint32_t document_count = ReadUint();
+    // id, relevance and rating take 16 bytes
+    if (document_count > data_.size() / 16) {
+        throw std::runtime_error("Truncated shard message"s);
+    }
+    std::vector<Document> documents(document_count);
+    for (Document& document : documents) {
+        document.id = ReadInt();
+        document.relevance = ReadDouble();
+        document.rating = ReadInt();
+    }
+    return documents;
+}
+
+std::string_view MessageReader::Take(size_t size) {
+    if (size > data_.size()) {
+        throw std::runtime_error("Truncated shard message"s);
+    }
+    const std::string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "term_statistics.h"
+
+// Binary protocol between ShardCoordinator and ShardServer. Every request and response is one
+// frame (see SendFrame); the first byte is the request type or the response status, followed by
+// little-endian integers, doubles and length-prefixed strings.
+
+enum class ShardRequest : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT,
+    GET_TERM_STATISTICS,
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+};
+
+enum class ShardResponse : uint8_t {
+    OK = 0,
+    INVALID_ARGUMENT,
+    OUT_OF_RANGE,
+    ERROR,
+};
+
+class MessageWriter {
+public:
+    void WriteByte(uint8_t value);
+    void WriteInt(int32_t value);
+    void WriteUint(uint32_t value);
+    void WriteUint64(uint64_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+    void WriteStatistics(const TermStatistics& statistics);
+    void WriteDocuments(const std::vector<Document>& documents);
+
+    const std::string& GetData() const;
+
+private:
+    std::string data_;
+};
+
+// Throws std::runtime_error when the message is shorter than expected
+class MessageReader {
+public:
+    explicit MessageReader(std::string_view data);
+
+    uint8_t ReadByte();
+    int32_t ReadInt();
+    uint32_t ReadUint();
+    uint64_t ReadUint64();
+    double ReadDouble();
+    // Throws std::invalid_argument for a byte that is not a DocumentStatus
+    DocumentStatus ReadStatus();
+    std::string ReadString();
+    // Points into the message data
+    std::string_view ReadStringView();
+
+    TermStatistics ReadStatistics();
+    std::vector<Document> ReadDocuments();
+
+private:
+    std::string_view data_;
+
+    std::string_view Take(size_t size);
+};
@@ -0,0 +1,171 @@
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "shard_protocol.h"
+#include "shard_server.h"
+
+ShardServer::ShardServer(SearchServer& search_server, const Endpoint& endpoint)
+    : search_server_(search_server)
+    , endpoint_(endpoint) {
+    listener_ = Listen(endpoint_);
+    int stop_pipe[2];
+    if (pipe(stop_pipe) < 0) {
+        throw SocketError("Cannot create stop pipe"s);
+    }
+    stop_reader_ = Socket(stop_pipe[0]);
+    stop_writer_ = Socket(stop_pipe[1]);
+}
+
+ShardServer::~ShardServer() {
+    Stop();
+    for (auto& connection : connections_) {
+        connection->socket.Shutdown();
+        connection->thread.join();
+    }
+    if (!endpoint_.unix_path.empty()) {
+        unlink(endpoint_.unix_path.c_str());
+    }
+}
+
+const Endpoint& ShardServer::GetEndpoint() const {
+    return endpoint_;
+}
+
+void ShardServer::Serve() {
+    while (!stopping_) {
+        pollfd poll_fds[2] = { { listener_.Get(), POLLIN, 0 }, { stop_reader_.Get(), POLLIN, 0 } };
+        if (poll(poll_fds, 2, -1) < 0 || !(poll_fds[0].revents & POLLIN)) {
+            continue;
+        }
+        JoinFinishedConnections();
+        auto connection = std::make_unique<Connection>();
+        try {
+            connection->socket = Accept(listener_);
+        }
+        catch (const SocketError&) {
+            // The client gave up before the connection was accepted
+            continue;
+        }
+        Connection& accepted = *connection;
+        connections_.push_back(std::move(connection));
+        accepted.thread = std::thread([this, &accepted] {
+            HandleConnection(accepted);
+            });
+    }
+    for (auto& connection : connections_) {
+        connection->socket.Shutdown();
+    }
+}
+
+void ShardServer::Stop() {
+    if (!stopping_.exchange(true)) {
+        const char byte = 0;
+        [[maybe_unused]] const ssize_t written = write(stop_writer_.Get(), &byte, 1);
+    }
+}
+
+void ShardServer::HandleConnection(Connection& connection) {
+    try {
+        while (!stopping_) {
+            const std::string request = ReceiveFrame(connection.socket);
+            SendFrame(connection.socket, HandleRequest(request));
+        }
+    }
+    catch (const SocketError&) {
+        // The coordinator disconnected or the server is stopping
+    }
+    connection.finished = true;
+}
+
+std::string ShardServer::HandleRequest(std::string_view request) {
+    MessageWriter response;
+    try {
+        MessageReader reader(request);
+        switch (static_cast<ShardRequest>(reader.ReadByte())) {
+        case ShardRequest::ADD_DOCUMENT: {
+            const int document_id = reader.ReadInt();
+            const DocumentStatus status = reader.ReadStatus();
+            std::vector<int> ratings;
+            for (uint32_t rating_count = reader.ReadUint(); rating_count > 0; --rating_count) {
+                ratings.push_back(reader.ReadInt());
+            }
+            const std::string document = reader.ReadString();
+            std::unique_lock lock(index_mutex_);
+            search_server_.AddDocument(document_id, document, status, ratings);
+            response.WriteByte(static_cast<uint8_t>(ShardResponse::OK));
+            break;
+        }
+        case ShardRequest::REMOVE_DOCUMENT: {
+            const int document_id = reader.ReadInt();
+            std::unique_lock lock(index_mutex_);
+            search_server_.RemoveDocument(document_id);
+            response.WriteByte(static_cast<uint8_t>(ShardResponse::OK));
+            break;
+        }
+        case ShardRequest::GET_TERM_STATISTICS: {
+            const std::string raw_query = reader.ReadString();
+            std::shared_lock lock(index_mutex_);
+            const TermStatistics statistics = search_server_.GetTermStatistics(raw_query);
+            response.WriteByte(static_cast<uint8_t>(ShardResponse::OK));
+            response.WriteStatistics(statistics);
+            break;
+        }
+        case ShardRequest::FIND_TOP_DOCUMENTS: {
+            const std::string raw_query = reader.ReadString();
+            const DocumentStatus status = reader.ReadStatus();
+            const TermStatistics statistics = reader.ReadStatistics();
+            std::shared_lock lock(index_mutex_);
+            const auto documents = search_server_.FindTopDocuments(raw_query, StatusEquals{ status }, statistics);
+            response.WriteByte(static_cast<uint8_t>(ShardResponse::OK));
+            response.WriteDocuments(documents);
+            break;
+        }
+        case ShardRequest::MATCH_DOCUMENT: {
+            const std::string raw_query = reader.ReadString();
+            const int document_id = reader.ReadInt();
+            std::shared_lock lock(index_mutex_);
+            const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+            response.WriteByte(static_cast<uint8_t>(ShardResponse::OK));
+            response.WriteUint(static_cast<uint32_t>(words.size()));
+            for (const std::string& word : words) {
+                response.WriteString(word);
+            }
+            response.WriteByte(static_cast<uint8_t>(status));
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown shard request"s);
+        }
+        return response.GetData();
+    }
+    catch (const std::invalid_argument& error) {
+        response = MessageWriter();
+        response.WriteByte(static_cast<uint8_t>(ShardResponse::INVALID_ARGUMENT));
+        response.WriteString(error.what());
+    }
+    catch (const std::out_of_range& error) {
+        response = MessageWriter();
+        response.WriteByte(static_cast<uint8_t>(ShardResponse::OUT_OF_RANGE));
+        response.WriteString(error.what());
+    }
+    catch (const std::exception& error) {
+        response = MessageWriter();
+        response.WriteByte(static_cast<uint8_t>(ShardResponse::ERROR));
+        response.WriteString(error.what());
+    }
+    return response.GetData();
+}
+
+void ShardServer::JoinFinishedConnections() {
+    for (auto connection = connections_.begin(); connection != connections_.end();) {
+        if ((*connection)->finished) {
+            (*connection)->thread.join();
+            connection = connections_.erase(connection);
+        }
+        else {
+            ++connection;
+        }
+    }
+}
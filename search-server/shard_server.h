@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "search_server.h"
+#include "socket_io.h"
+
+// Serves a SearchServer to ShardCoordinator over the shard protocol (shard_protocol.h).
+// Every connection gets its own thread; queries run concurrently, updates exclusively.
+class ShardServer {
+public:
+    // Starts listening immediately; a TCP endpoint with port 0 gets a free port, see GetEndpoint
+    ShardServer(SearchServer& search_server, const Endpoint& endpoint);
+
+    ShardServer(const ShardServer&) = delete;
+    ShardServer& operator=(const ShardServer&) = delete;
+
+    ~ShardServer();
+
+    const Endpoint& GetEndpoint() const;
+
+    // Accepts and serves connections until Stop() is called
+    void Serve();
+
+    // Safe to call from another thread or a signal handler
+    void Stop();
+
+private:
+    struct Connection {
+        Socket socket;
+        std::thread thread;
+        std::atomic<bool> finished = false;
+    };
+
+    SearchServer& search_server_;
+    std::shared_mutex index_mutex_;
+    Endpoint endpoint_;
+    Socket listener_;
+    Socket stop_reader_;
+    Socket stop_writer_;
+    std::atomic<bool> stopping_ = false;
+    std::list<std::unique_ptr<Connection>> connections_;
+
+    void HandleConnection(Connection& connection);
+
+    std::string HandleRequest(std::string_view request);
+
+    void JoinFinishedConnections();
+};
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "sharded_search_server.h"
+#include "string_processing.h"
+
+namespace {
+
+size_t GetDefaultShardCount() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+}  // namespace
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, size_t shard_count)
+    : pool_(shard_count > 0 ? shard_count : GetDefaultShardCount()) {
+    const std::vector<std::string> stop_words = SplitIntoWords(stop_words_text);
+    for (size_t shard = 0; shard < pool_.GetThreadCount(); ++shard) {
+        shards_.push_back(std::make_unique<SearchServer>(stop_words));
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+    const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    SearchServer& shard = GetShard(document_id);
+    shard.AddDocument(document_id, document, status, ratings);
+    for (const auto& [word, _] : shard.GetIndexedWordFrequencies(document_id)) {
+        const std::string_view word_view = word;
+        const auto document_freq = document_freqs_.lower_bound(word_view);
+        if (document_freq != document_freqs_.end() && document_freq->first == word_view) {
+            ++document_freq->second;
+        }
+        else {
+            document_freqs_.emplace_hint(document_freq, word_view, 1);
+        }
+    }
+    ++document_count_;
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    SearchServer& shard = GetShard(document_id);
+    if (!shard.HasDocument(document_id)) {
+        return;
+    }
+    for (const auto& [word, _] : shard.GetIndexedWordFrequencies(document_id)) {
+        const auto document_freq = document_freqs_.find(std::string_view(word));
+        if (--document_freq->second == 0) {
+            document_freqs_.erase(document_freq);
+        }
+    }
+    shard.RemoveDocument(document_id);
+    --document_count_;
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, StatusEquals{ status });
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::string& raw_query,
+    int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range("Invalid document_id"s);
+    }
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return document_count_;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+TermStatistics ShardedSearchServer::GetTermStatistics(const std::string& raw_query) const {
+    // Prefix words expand to different words in every shard, so the words of all shards are
+    // collected; the frequencies are then replaced with global ones
+    TermStatistics statistics;
+    for (const auto& shard : shards_) {
+        statistics.Merge(shard->GetTermStatistics(raw_query));
+    }
+    statistics.document_count = document_count_;
+    for (auto& [word, document_freq] : statistics.document_freqs) {
+        const auto global_freq = document_freqs_.find(word);
+        document_freq = global_freq == document_freqs_.end() ? 0 : global_freq->second;
+    }
+    return statistics;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "term_statistics.h"
+#include "thread_pool.h"
+
+// Partitions documents by id across several SearchServer shards and queries them in parallel.
+// Document frequencies of all words are kept for the whole corpus and passed to every shard,
+// so relevance is the same as with a single SearchServer; the top documents of the shards
+// are then merged. Like SearchServer, it must not be modified while queries are running.
+class ShardedSearchServer {
+public:
+    // 0 shards means one per hardware thread
+    explicit ShardedSearchServer(const std::string& stop_words_text, size_t shard_count = 0);
+
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    std::vector<std::unique_ptr<SearchServer>> shards_;
+    std::map<std::string, int, std::less<>> document_freqs_;
+    int document_count_ = 0;
+    // Declared last, so the workers stop before the shards are destroyed
+    mutable ThreadPool pool_;
+
+    const SearchServer& GetShard(int document_id) const;
+
+    SearchServer& GetShard(int document_id);
+
+    TermStatistics GetTermStatistics(const std::string& raw_query) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string& raw_query,
+    DocumentPredicate document_predicate) const {
+    const TermStatistics statistics = GetTermStatistics(raw_query);
+
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    pool_.ParallelFor(shards_.size(), [&](size_t shard_index) {
+        shard_documents[shard_index] = shards_[shard_index]->FindTopDocuments(raw_query, document_predicate, statistics);
+        });
+
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    SearchServer::KeepTopDocuments(matched_documents);
+    return matched_documents;
+}
@@ -0,0 +1,363 @@
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_io.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+inline constexpr uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+inline constexpr uint32_t MAX_PORT = 65535;
+
+[[noreturn]] void ThrowSystemError(const std::string& action) {
+    throw SocketError(action + ": "s + std::strerror(errno));
+}
+
+// Waits until the socket is ready for the given poll events or the deadline passes
+void WaitFor(const Socket& socket, short events, SocketClock::time_point deadline) {
+    while (true) {
+        int timeout_ms = -1;
+        if (deadline != NO_DEADLINE) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - SocketClock::now());
+            if (left.count() <= 0) {
+                throw SocketError("Deadline exceeded"s);
+            }
+            timeout_ms = static_cast<int>(left.count());
+        }
+        pollfd poll_fd{ socket.Get(), events, 0 };
+        const int ready = poll(&poll_fd, 1, timeout_ms);
+        if (ready > 0) {
+            return;
+        }
+        if (ready < 0 && errno != EINTR) {
+            ThrowSystemError("poll"s);
+        }
+    }
+}
+
+void SendAll(const Socket& socket, const char* data, size_t size, SocketClock::time_point deadline) {
+    while (size > 0) {
+        WaitFor(socket, POLLOUT, deadline);
+        const ssize_t sent = send(socket.Get(), data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            ThrowSystemError("send"s);
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+}
+
+void ReceiveAll(const Socket& socket, char* data, size_t size, SocketClock::time_point deadline) {
+    while (size > 0) {
+        WaitFor(socket, POLLIN, deadline);
+        const ssize_t received = recv(socket.Get(), data, size, MSG_DONTWAIT);
+        if (received == 0) {
+            throw SocketError("Connection closed"s);
+        }
+        if (received < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            ThrowSystemError("recv"s);
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+}
+
+sockaddr_un MakeUnixAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw SocketError("Unix socket path is too long: "s + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// A socket file left behind by a server that is gone makes bind fail, so it is removed. Anything
+// else at the path is kept: a file that is not a socket, or a socket a live server accepts on.
+void RemoveStaleUnixSocket(const std::string& path) {
+    struct stat status;
+    if (lstat(path.c_str(), &status) < 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        ThrowSystemError("lstat "s + path);
+    }
+    if (!S_ISSOCK(status.st_mode)) {
+        throw SocketError("Not a socket, refusing to replace: "s + path);
+    }
+    Socket probe(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!probe.IsOpen()) {
+        ThrowSystemError("socket"s);
+    }
+    const sockaddr_un address = MakeUnixAddress(path);
+    if (connect(probe.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        throw SocketError("Socket is in use: "s + path);
+    }
+    if (errno != ECONNREFUSED) {
+        ThrowSystemError("connect "s + path);
+    }
+    if (unlink(path.c_str()) < 0 && errno != ENOENT) {
+        ThrowSystemError("unlink "s + path);
+    }
+}
+
+sockaddr_in ResolveTcpAddress(const Endpoint& endpoint) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    const std::string host = endpoint.host.empty() ? "0.0.0.0"s : endpoint.host;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        throw SocketError("Cannot resolve "s + host);
+    }
+    sockaddr_in address = *reinterpret_cast<sockaddr_in*>(result->ai_addr);
+    freeaddrinfo(result);
+    address.sin_port = htons(endpoint.port);
+    return address;
+}
+
+}  // namespace
+
+Endpoint Endpoint::Parse(std::string_view text) {
+    Endpoint endpoint;
+    if (text.substr(0, 5) == "unix:") {
+        endpoint.unix_path = std::string(text.substr(5));
+        return endpoint;
+    }
+    if (text.substr(0, 4) == "tcp:") {
+        text.remove_prefix(4);
+    }
+    const size_t colon = text.rfind(':');
+    if (colon == std::string_view::npos) {
+        throw std::invalid_argument("Endpoint "s + std::string(text) + " has no port"s);
+    }
+    endpoint.host = std::string(text.substr(0, colon));
+    const std::string_view port = text.substr(colon + 1);
+    // Digits only: stoi would take a sign, skip spaces and ignore trailing garbage.
+    // Port 0 stays valid, it asks the system for a free port.
+    uint32_t port_number = 0;
+    for (const char c : port) {
+        port_number = c >= '0' && c <= '9' ? port_number * 10 + (c - '0') : MAX_PORT + 1;
+        if (port_number > MAX_PORT) {
+            break;
+        }
+    }
+    if (port.empty() || port_number > MAX_PORT) {
+        throw std::invalid_argument("Invalid port in endpoint "s + std::string(text));
+    }
+    endpoint.port = static_cast<uint16_t>(port_number);
+    return endpoint;
+}
+
+std::string Endpoint::ToString() const {
+    if (!unix_path.empty()) {
+        return "unix:"s + unix_path;
+    }
+    return "tcp:"s + host + ":"s + std::to_string(port);
+}
+
+Socket::Socket(int fd)
+    : fd_(fd) {
+}
+
+Socket::Socket(Socket&& other) noexcept
+    : fd_(other.fd_) {
+    other.fd_ = -1;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        Close();
+        fd_ = other.fd_;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+Socket::~Socket() {
+    Close();
+}
+
+int Socket::Get() const {
+    return fd_;
+}
+
+bool Socket::IsOpen() const {
+    return fd_ >= 0;
+}
+
+void Socket::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+void Socket::Shutdown() const {
+    if (fd_ >= 0) {
+        shutdown(fd_, SHUT_RDWR);
+    }
+}
+
+Socket Listen(Endpoint& endpoint) {
+    if (!endpoint.unix_path.empty()) {
+        Socket listener(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!listener.IsOpen()) {
+            ThrowSystemError("socket"s);
+        }
+        RemoveStaleUnixSocket(endpoint.unix_path);
+        const sockaddr_un address = MakeUnixAddress(endpoint.unix_path);
+        if (bind(listener.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            ThrowSystemError("bind "s + endpoint.unix_path);
+        }
+        if (listen(listener.Get(), SOMAXCONN) < 0) {
+            ThrowSystemError("listen"s);
+        }
+        return listener;
+    }
+
+    Socket listener(socket(AF_INET, SOCK_STREAM, 0));
+    if (!listener.IsOpen()) {
+        ThrowSystemError("socket"s);
+    }
+    const int enable = 1;
+    setsockopt(listener.Get(), SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address = ResolveTcpAddress(endpoint);
+    if (bind(listener.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        ThrowSystemError("bind "s + endpoint.ToString());
+    }
+    if (listen(listener.Get(), SOMAXCONN) < 0) {
+        ThrowSystemError("listen"s);
+    }
+    socklen_t address_size = sizeof(address);
+    getsockname(listener.Get(), reinterpret_cast<sockaddr*>(&address), &address_size);
+    endpoint.port = ntohs(address.sin_port);
+    return listener;
+}
+
+Socket Accept(const Socket& listener) {
+    while (true) {
+        const int fd = accept(listener.Get(), nullptr, nullptr);
+        if (fd >= 0) {
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            return Socket(fd);
+        }
+        if (errno != EINTR) {
+            ThrowSystemError("accept"s);
+        }
+    }
+}
+
+Socket Connect(const Endpoint& endpoint, SocketClock::time_point deadline) {
+    Socket connection;
+    int result = 0;
+    if (!endpoint.unix_path.empty()) {
+        connection = Socket(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!connection.IsOpen()) {
+            ThrowSystemError("socket"s);
+        }
+        const sockaddr_un address = MakeUnixAddress(endpoint.unix_path);
+        SetNonBlocking(connection);
+        result = connect(connection.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    }
+    else {
+        connection = Socket(socket(AF_INET, SOCK_STREAM, 0));
+        if (!connection.IsOpen()) {
+            ThrowSystemError("socket"s);
+        }
+        const int enable = 1;
+        setsockopt(connection.Get(), IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        const sockaddr_in address = ResolveTcpAddress(endpoint);
+        SetNonBlocking(connection);
+        result = connect(connection.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    }
+    if (result < 0 && errno != EINPROGRESS && errno != EAGAIN) {
+        ThrowSystemError("connect "s + endpoint.ToString());
+    }
+    if (result < 0) {
+        WaitFor(connection, POLLOUT, deadline);
+        int error = 0;
+        socklen_t error_size = sizeof(error);
+        getsockopt(connection.Get(), SOL_SOCKET, SO_ERROR, &error, &error_size);
+        if (error != 0) {
+            errno = error;
+            ThrowSystemError("connect "s + endpoint.ToString());
+        }
+    }
+    return connection;
+}
+
+void SetNonBlocking(const Socket& socket) {
+    const int flags = fcntl(socket.Get(), F_GETFL, 0);
+    fcntl(socket.Get(), F_SETFL, flags | O_NONBLOCK);
+}
+
+void SendFrame(const Socket& socket, std::string_view payload, SocketClock::time_point deadline) {
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    const char header[4] = { static_cast<char>(size), static_cast<char>(size >> 8),
+        static_cast<char>(size >> 16), static_cast<char>(size >> 24) };
+    SendAll(socket, header, sizeof(header), deadline);
+    SendAll(socket, payload.data(), payload.size(), deadline);
+}
+
+std::string ReceiveFrame(const Socket& socket, SocketClock::time_point deadline) {
+    unsigned char header[4];
+    ReceiveAll(socket, reinterpret_cast<char*>(header), sizeof(header), deadline);
+    const uint32_t size = header[0] | header[1] << 8 | header[2] << 16 | static_cast<uint32_t>(header[3]) << 24;
+    if (size > MAX_FRAME_SIZE) {
+        throw SocketError("Frame is too large"s);
+    }
+    std::string payload(size, '\0');
+    ReceiveAll(socket, payload.data(), payload.size(), deadline);
+    return payload;
+}
+
+void SendText(const Socket& socket, std::string_view text, SocketClock::time_point deadline) {
+    SendAll(socket, text.data(), text.size(), deadline);
+}
+
+std::string ReceiveLine(const Socket& socket, std::string& buffer, SocketClock::time_point deadline) {
+    size_t line_end = buffer.find('\n');
+    while (line_end == std::string::npos) {
+        if (buffer.size() > MAX_FRAME_SIZE) {
+            throw SocketError("Line is too long"s);
+        }
+        char chunk[4096];
+        WaitFor(socket, POLLIN, deadline);
+        const ssize_t received = recv(socket.Get(), chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (received == 0) {
+            throw SocketError("Connection closed"s);
+        }
+        if (received < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            ThrowSystemError("recv"s);
+        }
+        line_end = buffer.size();
+        buffer.append(chunk, static_cast<size_t>(received));
+        line_end = buffer.find('\n', line_end);
+    }
+    std::string line = buffer.substr(0, line_end > 0 && buffer[line_end - 1] == '\r' ? line_end - 1 : line_end);
+    buffer.erase(0, line_end + 1);
+    return line;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Thin blocking wrappers over POSIX sockets, used by the shard processes and the network front end
+
+using SocketClock = std::chrono::steady_clock;
+
+inline constexpr SocketClock::time_point NO_DEADLINE = SocketClock::time_point::max();
+
+// Thrown on network failures, timeouts and closed connections
+class SocketError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// "tcp:HOST:PORT" or "unix:PATH"; port 0 asks the system for a free port
+struct Endpoint {
+    std::string host;
+    uint16_t port = 0;
+    std::string unix_path;
+
+    static Endpoint Parse(std::string_view text);
+
+    std::string ToString() const;
+};
+
+class Socket {
+public:
+    Socket() = default;
+
+    explicit Socket(int fd);
+
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    ~Socket();
+
+    int Get() const;
+
+    bool IsOpen() const;
+
+    void Close();
+
+    // Wakes up threads blocked on the socket without releasing the descriptor
+    void Shutdown() const;
+
+private:
+    int fd_ = -1;
+};
+
+// Binds and listens; a TCP endpoint with port 0 is updated with the assigned port. A Unix socket
+// file left by a stopped server is replaced; any other file at the path is not, and is an error.
+Socket Listen(Endpoint& endpoint);
+
+Socket Accept(const Socket& listener);
+
+Socket Connect(const Endpoint& endpoint, SocketClock::time_point deadline = NO_DEADLINE);
+
+void SetNonBlocking(const Socket& socket);
+
+// Frames are a 32-bit little-endian length followed by the payload
+void SendFrame(const Socket& socket, std::string_view payload, SocketClock::time_point deadline = NO_DEADLINE);
+
+std::string ReceiveFrame(const Socket& socket, SocketClock::time_point deadline = NO_DEADLINE);
+
+// Plain byte stream helpers for the line-based protocol of QueryServer
+void SendText(const Socket& socket, std::string_view text, SocketClock::time_point deadline = NO_DEADLINE);
+
+// Returns the next line without the line break; bytes read past it are kept in buffer for the next call
+std::string ReceiveLine(const Socket& socket, std::string& buffer, SocketClock::time_point deadline = NO_DEADLINE);
@@ -19,4 +19,19 @@ std::vector<std::string> SplitIntoWords(const std::string& text) {
     }
 
     return words;
-}
\ No newline at end of file
+}
+
+std::pmr::vector<std::string_view> SplitIntoWordsView(std::string_view text, std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::string_view> words(resource);
+    size_t word_begin = 0;
+    for (size_t pos = 0; pos <= text.size(); ++pos) {
+        if (pos == text.size() || text[pos] == ' ') {
+            if (pos > word_begin) {
+                words.push_back(text.substr(word_begin, pos - word_begin));
+            }
+            word_begin = pos + 1;
+        }
+    }
+
+    return words;
+}
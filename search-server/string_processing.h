@@ -1,13 +1,15 @@
 #pragma once
 
 #include <iostream>
+#include<memory_resource>
 #include<set>
 #include<string>
+#include<string_view>
 #include<vector>
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string& str : strings) {
         if (!str.empty()) {
             non_empty_strings.emplace(str);
@@ -16,4 +18,8 @@ std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings)
     return non_empty_strings;
 }
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
\ No newline at end of file
+std::vector<std::string> SplitIntoWords(const std::string& text);
+
+// Same as SplitIntoWords, but the words point into text and the vector uses the given resource
+std::pmr::vector<std::string_view> SplitIntoWordsView(std::string_view text,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "term_dictionary.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+void WriteLength(std::string& data, size_t value) {
+    while (value >= 0x80) {
+        data += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    data += static_cast<char>(value);
+}
+
+size_t ReadLength(std::string_view data, size_t& offset) {
+    size_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        const auto byte = static_cast<unsigned char>(data[offset++]);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+// Decodes the terms of one block one by one into term, starting from its head
+class BlockReader {
+public:
+    BlockReader(std::string_view data, size_t offset)
+        : data_(data), offset_(offset) {
+        const size_t length = ReadLength(data_, offset_);
+        term_.assign(data_.substr(offset_, length));
+        offset_ += length;
+    }
+
+    const std::string& GetTerm() const {
+        return term_;
+    }
+
+    void Next() {
+        const size_t shared_length = ReadLength(data_, offset_);
+        const size_t suffix_length = ReadLength(data_, offset_);
+        term_.resize(shared_length);
+        term_.append(data_.substr(offset_, suffix_length));
+        offset_ += suffix_length;
+    }
+
+private:
+    std::string_view data_;
+    size_t offset_;
+    std::string term_;
+};
+
+}  // namespace
+
+TermDictionary::TermDictionary(const std::vector<std::string_view>& sorted_terms)
+    : term_count_(sorted_terms.size()) {
+    for (size_t index = 0; index < sorted_terms.size(); ++index) {
+        const std::string_view term = sorted_terms[index];
+        if (index > 0 && sorted_terms[index - 1] >= term) {
+            throw std::invalid_argument("Dictionary terms must be sorted and unique"s);
+        }
+        if (index % BLOCK_SIZE == 0) {
+            block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+            WriteLength(data_, term.size());
+            data_ += term;
+            continue;
+        }
+        const std::string_view previous = sorted_terms[index - 1];
+        const size_t shared_length = std::mismatch(previous.begin(), previous.begin() + std::min(previous.size(), term.size()),
+            term.begin()).first - previous.begin();
+        WriteLength(data_, shared_length);
+        WriteLength(data_, term.size() - shared_length);
+        data_ += term.substr(shared_length);
+    }
+    data_.shrink_to_fit();
+    block_offsets_.shrink_to_fit();
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return term_count_;
+}
+
+size_t TermDictionary::LowerBound(std::string_view term) const {
+    // The first block whose head is greater than the term; the answer is in the block before it
+    size_t low = 0;
+    size_t high = block_offsets_.size();
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (GetBlockHead(middle) <= term) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return 0;
+    }
+    const size_t block = low - 1;
+    size_t index = block * BLOCK_SIZE;
+    const size_t block_end = std::min(index + BLOCK_SIZE, term_count_);
+    BlockReader reader(data_, block_offsets_[block]);
+    while (reader.GetTerm() < term) {
+        if (++index == block_end) {
+            break;
+        }
+        reader.Next();
+    }
+    return index;
+}
+
+std::pair<size_t, size_t> TermDictionary::FindPrefixRange(std::string_view prefix) const {
+    const size_t first = LowerBound(prefix);
+    // Terms with the prefix end before the smallest string greater than all of them
+    std::string prefix_end(prefix);
+    while (!prefix_end.empty() && static_cast<unsigned char>(prefix_end.back()) == 0xFF) {
+        prefix_end.pop_back();
+    }
+    if (prefix_end.empty()) {
+        return { first, term_count_ };
+    }
+    ++prefix_end.back();
+    return { first, LowerBound(prefix_end) };
+}
+
+std::string TermDictionary::GetTerm(size_t index) const {
+    if (index >= term_count_) {
+        throw std::out_of_range("Term index is out of range"s);
+    }
+    BlockReader reader(data_, block_offsets_[index / BLOCK_SIZE]);
+    for (size_t i = index % BLOCK_SIZE; i > 0; --i) {
+        reader.Next();
+    }
+    return reader.GetTerm();
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    return data_.capacity() + block_offsets_.capacity() * sizeof(uint32_t);
+}
+
+std::string_view TermDictionary::GetBlockHead(size_t block) const {
+    size_t offset = block_offsets_[block];
+    const size_t length = ReadLength(data_, offset);
+    return std::string_view(data_).substr(offset, length);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Sorted terms, front-coded in blocks: the first term of a block is stored whole, every other
+// term as the length of the prefix it shares with the previous term plus the rest of it.
+// Lookups binary search the block heads and decode at most one block.
+class TermDictionary {
+public:
+    TermDictionary() = default;
+
+    // Terms must be sorted and unique
+    explicit TermDictionary(const std::vector<std::string_view>& sorted_terms);
+
+    size_t GetTermCount() const;
+
+    // Indexes of the first term not less than the given one
+    size_t LowerBound(std::string_view term) const;
+
+    // Half-open range of indexes of the terms starting with the prefix
+    std::pair<size_t, size_t> FindPrefixRange(std::string_view prefix) const;
+
+    std::string GetTerm(size_t index) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    inline static constexpr size_t BLOCK_SIZE = 16;
+
+    std::string data_;
+    std::vector<uint32_t> block_offsets_;
+    size_t term_count_ = 0;
+
+    std::string_view GetBlockHead(size_t block) const;
+};
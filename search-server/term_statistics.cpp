@@ -0,0 +1,8 @@
+#include "term_statistics.h"
+
+void TermStatistics::Merge(const TermStatistics& other) {
+    document_count += other.document_count;
+    for (const auto& [word, document_freq] : other.document_freqs) {
+        document_freqs[word] += document_freq;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+
+// Corpus statistics that relevance depends on: the number of documents and, for every query word,
+// the number of documents containing it. When a corpus is split across several indexes, summing
+// their statistics lets each part rank documents exactly as a single index over the whole corpus would.
+struct TermStatistics {
+    int document_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;
+
+    void Merge(const TermStatistics& other);
+};
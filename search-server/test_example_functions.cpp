@@ -1,17 +1,33 @@
 
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <sys/socket.h>
+
+#include "durable_search_server.h"
 #include "paginator.h"
+#include "query_arena.h"
+#include "query_server.h"
 #include "remove_duplicates.h"
 #include "request_queue.h"
+#include "score_accumulator.h"
+#include "segmented_search_server.h"
+#include "shard_coordinator.h"
+#include "shard_server.h"
+#include "sharded_search_server.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
 #include "test_example_functions.h"
 
 // --------      ----------
@@ -228,7 +244,7 @@ void TestRelevanceComputing() {
             continue;
         }
         const double idf = std::log(doc_count * 1.0 / word_to_document_freqs.at(word).size());
-        for (const auto [doc_id, tf] : word_to_document_freqs.at(word)) {
+        for (const auto& [doc_id, tf] : word_to_document_freqs.at(word)) {
             document_to_relevance[doc_id] += tf * idf;
         }
     }
@@ -334,6 +350,1208 @@ void Test_RemoveDuplicates() {
     ASSERT_EQUAL_HINT(search_server.GetDocumentCount(), 4, "Wrong number of documents after removing duplicates"s);
 }
 
+void TestRemoveDocument() {
+    const std::vector<int> ratings = { 1, 2, 3 };
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(10, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+    search_server.AddDocument(11, "funny white cat"s, DocumentStatus::ACTUAL, ratings);
+    search_server.AddDocument(12, "fluffy grey dog"s, DocumentStatus::ACTUAL, ratings);
+
+    search_server.RemoveDocument(11);
+    search_server.RemoveDocument(100);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+    ASSERT_HINT(search_server.GetWordFrequencies(11).empty(), "Removed document must have no words"s);
+    // : std::map     std::set
+    const std::map<std::string, double>& word_freqs = search_server.GetWordFrequencies(12);
+    ASSERT_EQUAL(word_freqs.size(), 3u);
+    ASSERT_EQUAL(word_freqs.at("dog"s), search_server.GetIndexedWordFrequencies(12).find(std::string_view("dog"))->second);
+    ASSERT(&search_server.GetWordFrequencies(12) == &word_freqs);
+    const std::set<int>::const_iterator first_id = search_server.begin();
+    ASSERT_EQUAL(*first_id, 10);
+    //    cat  
+    const auto found_docs = search_server.FindTopDocuments("white cat"s);
+    ASSERT_EQUAL_HINT(found_docs.size(), 1u, "Removing a document must not remove words of other documents"s);
+    ASSERT_EQUAL(found_docs[0].id, 10);
+
+    //      ,    
+    PostingList<double> postings;
+    for (int ordinal = 0; ordinal < 6; ++ordinal) {
+        postings[ordinal] = ordinal * 0.5;
+    }
+    postings.erase(1);
+    postings.erase(4);
+    ASSERT_EQUAL(postings.size(), 4u);
+    ASSERT_EQUAL(postings.count(4), 0u);
+    ASSERT_EQUAL(postings.lower_bound(4)->first, 5);
+    std::vector<int> ordinals;
+    for (const auto& [ordinal, _] : postings) {
+        ordinals.push_back(ordinal);
+    }
+    ASSERT_EQUAL(ordinals, std::vector<int>({ 0, 2, 3, 5 }));
+    postings[1] += 1.0;
+    ASSERT_EQUAL(postings.find(1)->second, 1.0);
+    postings.erase(0);
+    postings.erase(2);
+    postings.erase(3);
+    ASSERT_EQUAL(postings.size(), 2u);
+    ASSERT_EQUAL(postings.begin()->first, 1);
+
+    //          
+    SearchServer churned_server(""s);
+    churned_server.SetImpactOrderThreshold(20);
+    std::map<int, std::string> live_texts;
+    const auto text_of = [](int id) {
+        return "w"s + std::to_string(id % 7) + " w"s + std::to_string(id % 11) + " common"s;
+    };
+    for (int id = 0; id < 300; ++id) {
+        churned_server.AddDocument(id, text_of(id), static_cast<DocumentStatus>(id % 2), { id % 5 });
+        live_texts[id] = text_of(id);
+        if (id % 3 != 0) {
+            churned_server.RemoveDocument(id - 1);
+            live_texts.erase(id - 1);
+        }
+    }
+    SearchServer rebuilt_server(""s);
+    for (const auto& [id, text] : live_texts) {
+        rebuilt_server.AddDocument(id, text, static_cast<DocumentStatus>(id % 2), { id % 5 });
+    }
+    ASSERT_EQUAL(churned_server.GetDocumentCount(), rebuilt_server.GetDocumentCount());
+    ASSERT_EQUAL(churned_server.GetMemoryStats().posting_count, rebuilt_server.GetMemoryStats().posting_count);
+    for (const std::string& query : { "common"s, "w3 w5"s, "common -w2"s, "w0 w1 w4"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT }) {
+            const auto churned = churned_server.FindTopDocuments(query, status);
+            const auto rebuilt = rebuilt_server.FindTopDocuments(query, status);
+            ASSERT_EQUAL(churned.size(), rebuilt.size());
+            for (size_t i = 0; i < churned.size(); ++i) {
+                ASSERT_EQUAL(churned[i].id, rebuilt[i].id);
+                ASSERT(std::abs(churned[i].relevance - rebuilt[i].relevance) < SearchServer::COMPARISON_ACCURACY_FOR_DOUBLE);
+            }
+        }
+    }
+    const int last_id = live_texts.rbegin()->first;
+    ASSERT(std::get<0>(churned_server.MatchDocument("common w1"s, last_id))
+        == std::get<0>(rebuilt_server.MatchDocument("common w1"s, last_id)));
+}
+
+void TestQueryArena() {
+    QueryArena arena(64);
+    {
+        QueryArena::Scope scope(arena);
+        std::pmr::vector<int> numbers(scope.Resource());
+        numbers.resize(1000);
+    }
+    //       
+    ASSERT_HINT(arena.GetBufferSize() >= 1000 * sizeof(int), "Arena must grow after overflow"s);
+    const size_t buffer_size = arena.GetBufferSize();
+    {
+        QueryArena::Scope scope(arena);
+        std::pmr::vector<int> numbers(scope.Resource());
+        numbers.resize(1000);
+    }
+    ASSERT_EQUAL(arena.GetBufferSize(), buffer_size);
+
+    //     ,      
+    QueryArena capped_arena(64, 1024);
+    {
+        QueryArena::Scope scope(capped_arena);
+        std::pmr::vector<int> numbers(scope.Resource());
+        numbers.resize(100000);
+    }
+    ASSERT_EQUAL(capped_arena.GetBufferSize(), 1024u);
+}
+
+void TestQueryContext() {
+    const std::vector<int> ratings = { 1, 2, 3 };
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(10, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+    search_server.AddDocument(11, "fluffy grey dog"s, DocumentStatus::BANNED, ratings);
+    search_server.AddDocument(12, "funny white cat"s, DocumentStatus::ACTUAL, { 3, 3, 3 });
+    search_server.AddDocument(13, "funny fluffy fox"s, DocumentStatus::ACTUAL, ratings);
+
+    QueryContext context;
+    for (const std::string& query : { "funny cat"s, "fluffy -fox"s, "cat cat funny -dog"s, "parrot"s }) {
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto& found_docs = search_server.FindTopDocuments(context, query);
+        ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), "Context query must find the same documents"s);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+            ASSERT_EQUAL(found_docs[i].relevance, expected[i].relevance);
+        }
+    }
+    const auto& found_docs = search_server.FindTopDocuments(context, "fluffy dog"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(found_docs.size(), 1u);
+    ASSERT_EQUAL(context.GetResults()[0].id, 11);
+}
+
+void TestIndexPredicates() {
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(10, "cat in the city"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    search_server.AddDocument(11, "fluffy grey cat"s, DocumentStatus::BANNED, { 8, -3 });
+    search_server.AddDocument(12, "funny white cat"s, DocumentStatus::ACTUAL, { 3, 3, 3 });
+    search_server.AddDocument(13, "funny fluffy fox"s, DocumentStatus::ACTUAL, { -1, 3, 4 });
+    search_server.AddDocument(14, "white fluffy cat"s, DocumentStatus::ACTUAL, { 5 });
+    search_server.RemoveDocument(12);
+    search_server.AddDocument(15, "grey cat"s, DocumentStatus::ACTUAL, { 3, 3, 3 });
+
+    const std::string query = "fluffy cat -fox"s;
+    const auto check = [&](const auto& predicate, const auto& lambda, const std::vector<int>& expected_ids) {
+        const auto found_docs = search_server.FindTopDocuments(query, predicate);
+        const auto expected_docs = search_server.FindTopDocuments(query, lambda);
+        std::vector<int> found_ids;
+        for (size_t i = 0; i < found_docs.size(); ++i) {
+            found_ids.push_back(found_docs[i].id);
+            ASSERT_EQUAL(found_docs[i].id, expected_docs[i].id);
+            ASSERT_EQUAL(found_docs[i].relevance, expected_docs[i].relevance);
+        }
+        ASSERT_EQUAL(found_ids, expected_ids);
+    };
+    check(StatusEquals{ DocumentStatus::BANNED },
+        [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::BANNED; }, { 11 });
+    check(RatingRange{ 3, 5 },
+        [](int document_id, DocumentStatus status, int rating) { return rating >= 3 && rating <= 5; }, { 14, 15 });
+    check(IdSet{ 10, 11, 14, 100 },
+        [](int document_id, DocumentStatus status, int rating) { return document_id != 15; }, { 14, 11, 10 });
+    check(StatusEquals{ DocumentStatus::ACTUAL } && IdSet{ 10, 11, 15 } && RatingRange{ 2, 3 },
+        [](int document_id, DocumentStatus status, int rating) { return document_id == 10 || document_id == 15; }, { 15, 10 });
+    check(StatusEquals{ DocumentStatus::ACTUAL } && StatusEquals{ DocumentStatus::BANNED },
+        [](int document_id, DocumentStatus status, int rating) { return false; }, {});
+}
+
+void TestAsyncQueries() {
+    SearchServer search_server("in the"s);
+    const std::vector<std::string> words = { "cat"s, "dog"s, "fluffy"s, "grey"s, "white"s, "funny"s, "fox"s };
+    for (int id = 0; id < 40000; ++id) {
+        std::string document = words[id % words.size()] + " "s + words[id / 7 % words.size()] + " "s + words[id / 49 % words.size()];
+        const DocumentStatus status = id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        search_server.AddDocument(id, document, status, { id % 11 });
+    }
+
+    ThreadPool pool(4);
+    ASSERT_EQUAL(pool.GetThreadCount(), 4u);
+    for (const std::string& query : { "fluffy cat"s, "grey dog fox -white"s, "funny"s, "parrot"s }) {
+        auto found_docs = search_server.FindTopDocumentsAsync(pool, query);
+        auto banned_docs = search_server.FindTopDocumentsAsync(pool, query, DocumentStatus::BANNED);
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto expected_banned = search_server.FindTopDocuments(query, DocumentStatus::BANNED);
+        const auto result = found_docs.get();
+        const auto banned_result = banned_docs.get();
+        ASSERT_EQUAL(result.size(), expected.size());
+        ASSERT_EQUAL(banned_result.size(), expected_banned.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(result[i].relevance, expected[i].relevance);
+            ASSERT_EQUAL(result[i].rating, expected[i].rating);
+        }
+        for (size_t i = 0; i < expected_banned.size(); ++i) {
+            ASSERT_EQUAL(banned_result[i].relevance, expected_banned[i].relevance);
+        }
+    }
+
+    const auto [matched_words, status] = search_server.MatchDocumentAsync(pool, "cat fox -parrot"s, 6).get();
+    ASSERT_EQUAL(matched_words, (std::vector<std::string>{ "cat"s, "fox"s }));
+    ASSERT(status == DocumentStatus::ACTUAL);
+
+    std::vector<int> squares(100);
+    pool.ParallelFor(squares.size(), [&squares](size_t i) { squares[i] = static_cast<int>(i * i); });
+    ASSERT_EQUAL(squares[99], 99 * 99);
+
+    //      ,    
+    std::atomic<int> finished = 0;
+    pool.ParallelFor(8, [&pool, &finished](size_t) {
+        pool.ParallelFor(2, [&finished](size_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ++finished;
+            });
+        });
+    ASSERT_EQUAL(finished.load(), 16);
+
+#ifdef __linux__
+    //   -  ,     
+    bool thrown = false;
+    try {
+        ThreadPool pinned_pool(ThreadPoolOptions{ 2, { 100000 } });
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+#endif
+}
+
+void TestSegmentedSearchServer() {
+    SegmentedSearchServerOptions options;
+    options.max_buffered_documents = 3;
+    options.refresh_interval = std::chrono::milliseconds(0);
+    options.max_segment_count = 2;
+    SegmentedSearchServer segmented_server("in the"s, options);
+    SearchServer search_server("in the"s);
+    const std::vector<std::string> documents = { "cat in the city"s, "fluffy grey dog"s, "funny white cat"s,
+        "funny fluffy fox"s, "white cat with long tail"s, "grey hound"s, "black cat"s, "fluffy cat and fluffy dog"s };
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        segmented_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { id });
+        search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { id });
+    }
+    //       Refresh
+    ASSERT_EQUAL(segmented_server.GetDocumentCount(), 6);
+    segmented_server.Refresh();
+    ASSERT_EQUAL(segmented_server.GetDocumentCount(), 8);
+
+    segmented_server.RemoveDocument(2);
+    segmented_server.RemoveDocument(7);
+    search_server.RemoveDocument(2);
+    search_server.RemoveDocument(7);
+    segmented_server.WaitForMerges();
+    ASSERT_HINT(segmented_server.GetSegmentCount() <= 2u, "Segments must be merged in the background"s);
+    ASSERT_EQUAL(segmented_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+    for (const std::string& query : { "fluffy cat"s, "grey dog -hound"s, "white funny fox"s }) {
+        const auto found_docs = segmented_server.FindTopDocuments(query);
+        const auto expected = search_server.FindTopDocuments(query);
+        ASSERT_EQUAL(found_docs.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+            ASSERT_HINT(std::abs(found_docs[i].relevance - expected[i].relevance) < 1e-9, "Relevance must match a single index"s);
+        }
+    }
+    ASSERT_EQUAL(std::get<0>(segmented_server.MatchDocument("fluffy dog"s, 1)), (std::vector<std::string>{ "dog"s, "fluffy"s }));
+
+    //   
+    std::atomic<bool> writing = true;
+    std::thread reader([&segmented_server, &writing] {
+        while (writing) {
+            const auto found_docs = segmented_server.FindTopDocuments("cat"s);
+            ASSERT(found_docs.size() <= static_cast<size_t>(SearchServer::MAX_RESULT_DOCUMENT_COUNT));
+        }
+        });
+    for (int id = 100; id < 300; ++id) {
+        segmented_server.AddDocument(id, "cat number "s + std::to_string(id), DocumentStatus::ACTUAL, { 1 });
+        if (id % 3 == 0) {
+            segmented_server.RemoveDocument(id - 50);
+        }
+    }
+    writing = false;
+    reader.join();
+
+    //         
+    bool thrown = false;
+    try {
+        SegmentedSearchServer invalid_server("in the"s, SegmentedSearchServerOptions{ 10, std::chrono::milliseconds(0), 0 });
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestShardedSearchServer() {
+    ShardedSearchServer sharded_server("in the"s, 3);
+    SearchServer search_server("in the"s);
+    ASSERT_EQUAL(sharded_server.GetShardCount(), 3u);
+    const std::vector<std::string> documents = { "cat in the city"s, "fluffy grey dog"s, "funny white cat"s,
+        "funny fluffy fox"s, "white cat with long tail"s, "grey hound"s, "black cat"s, "fluffy cat and fluffy dog"s };
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        const DocumentStatus status = id == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        sharded_server.AddDocument(id, documents[id], status, { id });
+        search_server.AddDocument(id, documents[id], status, { id });
+    }
+    sharded_server.RemoveDocument(4);
+    search_server.RemoveDocument(4);
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+    for (const std::string& query : { "fluffy cat"s, "grey dog -hound"s, "white funny fox"s }) {
+        const auto found_docs = sharded_server.FindTopDocuments(query);
+        const auto expected = search_server.FindTopDocuments(query);
+        ASSERT_EQUAL(found_docs.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+            ASSERT_HINT(std::abs(found_docs[i].relevance - expected[i].relevance) < 1e-9, "Relevance must match a single index"s);
+        }
+    }
+    const auto banned_docs = sharded_server.FindTopDocuments("funny fox"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned_docs.size(), 1u);
+    ASSERT_EQUAL(banned_docs[0].id, 3);
+    ASSERT_EQUAL(std::get<0>(sharded_server.MatchDocument("fluffy dog -cat"s, 1)), (std::vector<std::string>{ "dog"s, "fluffy"s }));
+}
+
+void TestShardCoordinator() {
+    //  -     ,    loopback
+    SearchServer first_index("in the"s);
+    SearchServer second_index("in the"s);
+    ShardServer first_shard(first_index, Endpoint::Parse("tcp:127.0.0.1:0"s));
+    ShardServer second_shard(second_index, Endpoint::Parse("tcp:127.0.0.1:0"s));
+    std::thread first_thread([&first_shard] { first_shard.Serve(); });
+    std::thread second_thread([&second_shard] { second_shard.Serve(); });
+    {
+        ShardCoordinator coordinator({ first_shard.GetEndpoint(), second_shard.GetEndpoint() }, { std::chrono::milliseconds(2000) });
+        SearchServer search_server("in the"s);
+        const std::vector<std::string> documents = { "cat in the city"s, "fluffy grey dog"s, "funny white cat"s,
+            "funny fluffy fox"s, "white cat with long tail"s, "grey hound"s, "black cat"s, "fluffy cat and fluffy dog"s };
+        for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+            const DocumentStatus status = id == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            coordinator.AddDocument(id, documents[id], status, { id });
+            search_server.AddDocument(id, documents[id], status, { id });
+        }
+        coordinator.RemoveDocument(4);
+        search_server.RemoveDocument(4);
+        ASSERT_EQUAL(first_index.GetDocumentCount() + second_index.GetDocumentCount(), search_server.GetDocumentCount());
+
+        for (const std::string& query : { "fluffy cat"s, "grey dog -hound"s, "white funny fox"s }) {
+            const auto found = coordinator.FindTopDocuments(query);
+            const auto expected = search_server.FindTopDocuments(query);
+            ASSERT_EQUAL(found.missed_shard_count, 0u);
+            ASSERT_EQUAL(found.documents.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(found.documents[i].id, expected[i].id);
+                ASSERT_HINT(std::abs(found.documents[i].relevance - expected[i].relevance) < 1e-9, "Relevance must match a single index"s);
+            }
+        }
+        const auto banned = coordinator.FindTopDocuments("funny fox"s, DocumentStatus::BANNED);
+        ASSERT_EQUAL(banned.documents.size(), 1u);
+        ASSERT_EQUAL(banned.documents[0].id, 3);
+        ASSERT_EQUAL(std::get<0>(coordinator.MatchDocument("fluffy dog -cat"s, 1)), (std::vector<std::string>{ "dog"s, "fluffy"s }));
+
+        //       
+        bool thrown = false;
+        try {
+            coordinator.FindTopDocuments("fluffy --cat"s);
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        thrown = false;
+        try {
+            coordinator.MatchDocument("cat"s, 4);
+        }
+        catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        //    ,      
+        thrown = false;
+        try {
+            coordinator.AddDocument(10, "grey cat"s, static_cast<DocumentStatus>(7), { 1 });
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(first_index.GetDocumentCount() + second_index.GetDocumentCount(), search_server.GetDocumentCount());
+
+        //    ,    
+        second_shard.Stop();
+        second_thread.join();
+        const auto partial = coordinator.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(partial.missed_shard_count, 1u);
+        ASSERT(!partial.documents.empty());
+    }
+    first_shard.Stop();
+    first_thread.join();
+}
+
+void TestQueryServer() {
+    SearchServer search_server("in the"s);
+    search_server.AddDocument(1, "white cat in the city"s, DocumentStatus::ACTUAL, { 8, -3 });
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    QueryServerOptions options;
+    options.thread_count = 2;
+    options.max_connection_batch_size = 2;
+    QueryServer query_server(search_server, Endpoint::Parse("tcp:127.0.0.1:0"s), options);
+    std::thread server_thread([&query_server] { query_server.Serve(); });
+
+    //    ,      
+    Socket client = Connect(query_server.GetEndpoint());
+    SendText(client, "FIND fluffy cat\nADD 3 BANNED 5,6 grey dog\r\nMATCH 3 grey cat\nFIND dog\nMATCH 7 cat\nFIND --cat\nHELLO\n"s);
+    std::string buffer;
+    const std::string find_response = ReceiveLine(client, buffer);
+    ASSERT_EQUAL(find_response.substr(0, 11), "OK 2:0.3465"s);
+    ASSERT_EQUAL(find_response.substr(find_response.size() - 8), ":5 1:0:2"s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer), "OK"s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer), "OK BANNED grey"s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer), "OK"s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer).substr(0, 4), "ERR "s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer).substr(0, 4), "ERR "s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer), "ERR Unknown command HELLO"s);
+    ASSERT(search_server.HasDocument(3));
+
+    //   ,   ,   
+    {
+        Socket second_client = Connect(query_server.GetEndpoint());
+        SendText(second_client, "FIND white\nFIND grey\n"s);
+    }
+    SendText(client, "FIND white\n"s);
+    ASSERT_EQUAL(ReceiveLine(client, buffer).substr(0, 5), "OK 1:"s);
+
+    //      :      
+    {
+        Socket closing_client = Connect(query_server.GetEndpoint());
+        SendText(closing_client, "FIND white\nFIND tail\nMATCH 1 city\n"s);
+        shutdown(closing_client.Get(), SHUT_WR);
+        std::string closing_buffer;
+        ASSERT_EQUAL(ReceiveLine(closing_client, closing_buffer).substr(0, 5), "OK 1:"s);
+        ASSERT_EQUAL(ReceiveLine(closing_client, closing_buffer).substr(0, 5), "OK 2:"s);
+        ASSERT_EQUAL(ReceiveLine(closing_client, closing_buffer), "OK ACTUAL city"s);
+    }
+
+    query_server.Stop();
+    server_thread.join();
+}
+
+void TestSearchAfterPagination() {
+    SearchServer search_server("and"s);
+    // 23      ,     
+    for (int id = 0; id < 23; ++id) {
+        const std::string text = id % 3 == 0 ? "cat and dog"s : id % 3 == 1 ? "cat cat dog"s : "grey cat"s;
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 4 });
+    }
+    search_server.AddDocument(23, "cat"s, DocumentStatus::BANNED, { 1 });
+
+    ResultPager all_pager = search_server.FindDocumentPages("cat dog"s);
+    ASSERT_EQUAL(all_pager.GetRemainingCount(), 23u);
+    const std::vector<Document> all_documents = all_pager.NextPage(100).documents;
+    ASSERT(!all_pager.HasNextPage());
+    for (size_t i = 1; i < all_documents.size(); ++i) {
+        ASSERT(SearchServer::IsRankedBefore(all_documents[i - 1], all_documents[i]));
+    }
+    const auto top_documents = search_server.FindTopDocuments("cat dog"s);
+    for (size_t i = 0; i < top_documents.size(); ++i) {
+        ASSERT_EQUAL(top_documents[i].id, all_documents[i].id);
+    }
+
+    //    pager      
+    ResultPager pager = search_server.FindDocumentPages("cat dog"s);
+    std::optional<SearchCursor> cursor;
+    size_t position = 0;
+    do {
+        const ResultPage page = search_server.FindTopDocumentsAfter("cat dog"s, cursor, 4);
+        const ResultPage lazy_page = pager.NextPage(4);
+        ASSERT_EQUAL(page.documents.size(), lazy_page.documents.size());
+        ASSERT_EQUAL(page.next.has_value(), lazy_page.next.has_value());
+        for (size_t i = 0; i < page.documents.size(); ++i, ++position) {
+            ASSERT_EQUAL(page.documents[i].id, all_documents[position].id);
+            ASSERT_EQUAL(lazy_page.documents[i].id, all_documents[position].id);
+        }
+        cursor = page.next;
+    } while (cursor);
+    ASSERT_EQUAL(position, all_documents.size());
+
+    const ResultPage banned_page = search_server.FindTopDocumentsAfter("cat"s, DocumentStatus::BANNED, std::nullopt, 4);
+    ASSERT_EQUAL(banned_page.documents.size(), 1u);
+    ASSERT(!banned_page.next);
+
+    //  Paginate   
+    const std::vector<int> numbers = { 1, 2, 3, 4, 5, 6, 7 };
+    const auto pages = Paginate(numbers, 3);
+    ASSERT_EQUAL(pages.size(), 3u);
+    std::vector<size_t> page_sizes;
+    for (const auto& page : pages) {
+        page_sizes.push_back(page.size());
+    }
+    ASSERT_EQUAL(page_sizes, (std::vector<size_t>{ 3, 3, 1 }));
+
+    //    
+    bool thrown = false;
+    try {
+        Paginate(numbers, 0);
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestStreamingResults() {
+    SearchServer search_server("and"s);
+    for (int id = 0; id < 300; ++id) {
+        const std::string text = (id % 2 == 0 ? "cat"s : "dog"s) + (id % 3 == 0 ? " grey"s : " white"s) + (id % 5 == 0 ? " fluffy"s : ""s);
+        search_server.AddDocument(id, text, id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 10 });
+    }
+    search_server.RemoveDocument(10);
+
+    //        ,  
+    ResultPager pager = search_server.FindDocumentPages("cat grey -fluffy"s);
+    std::map<int, double> expected;
+    for (const Document& document : pager.NextPage(1000).documents) {
+        expected[document.id] = document.relevance;
+    }
+    std::map<int, double> streamed;
+    search_server.ForEachMatchedDocument("cat grey -fluffy"s, [&streamed](const Document& document) {
+        streamed[document.id] = document.relevance;
+        });
+    ASSERT_EQUAL(streamed.size(), expected.size());
+    for (const auto& [id, relevance] : expected) {
+        ASSERT_EQUAL(streamed.count(id), 1u);
+        ASSERT(std::abs(streamed.at(id) - relevance) < 1e-9);
+    }
+
+    size_t banned_count = 0;
+    search_server.ForEachMatchedDocument("dog"s, DocumentStatus::BANNED, [&banned_count](const Document& document) {
+        ASSERT(document.id % 7 == 0 && document.id % 2 == 1);
+        ++banned_count;
+        });
+    ASSERT_EQUAL(banned_count, 21u);
+
+    std::vector<int> rated_ids;
+    search_server.ForEachMatchedDocument("fluffy"s, [](int, DocumentStatus, int rating) { return rating == 5; },
+        [&rated_ids](const Document& document) {
+            rated_ids.push_back(document.id);
+        });
+    ASSERT_EQUAL(rated_ids.size(), 30u);
+
+    //  -,    ,   ,   
+    std::set<int> expected_ids;
+    for (const Document& document : search_server.FindDocumentPages("cat -grey -fluffy -parrot"s).NextPage(1000).documents) {
+        expected_ids.insert(document.id);
+    }
+    std::set<int> streamed_ids;
+    search_server.ForEachMatchedDocument("cat -grey -fluffy -parrot"s, [&streamed_ids](const Document& document) {
+        streamed_ids.insert(document.id);
+        });
+    ASSERT_EQUAL(streamed_ids, expected_ids);
+    ASSERT_EQUAL(streamed_ids.size(), 69u);
+
+    //  ,    false
+    size_t visited = 0;
+    search_server.ForEachMatchedDocument("cat dog"s, [&visited](const Document&) {
+        return ++visited < 5;
+        });
+    ASSERT_EQUAL(visited, 5u);
+}
+
+//  CompactSearchServer (  float)    double:
+//       ,   double,  
+// COMPARISON_ACCURACY_FOR_DOUBLE,    ,     .
+// SearchServer     .
+void TestPostingStorageMode() {
+    const int document_count = 2000;
+    const int vocabulary_size = 300;
+    uint32_t seed = 17;
+    const auto next_random = [&seed](int bound) {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<int>((seed >> 8) % static_cast<uint32_t>(bound));
+    };
+
+    SearchServer search_server(""s);
+    CompactSearchServer compact_server(""s);
+    std::vector<std::map<int, double>> document_word_freqs(document_count);
+    std::map<int, int> word_document_freqs;
+    std::vector<int> ratings(document_count);
+    for (int id = 0; id < document_count; ++id) {
+        const int word_count = 3 + next_random(20);
+        std::string text;
+        for (int i = 0; i < word_count; ++i) {
+            //     ,    
+            const int word = next_random(vocabulary_size) * next_random(vocabulary_size) / vocabulary_size;
+            text += "w"s + std::to_string(word) + " "s;
+            document_word_freqs[id][word] += 1.0 / word_count;
+        }
+        for (const auto& [word, _] : document_word_freqs[id]) {
+            ++word_document_freqs[word];
+        }
+        ratings[id] = next_random(10);
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { ratings[id] });
+        compact_server.AddDocument(id, text, DocumentStatus::ACTUAL, { ratings[id] });
+    }
+    //    float    ,    
+    ASSERT(compact_server.GetMemoryStats().postings_bytes < search_server.GetMemoryStats().postings_bytes);
+    static_assert(std::is_same_v<CompactSearchServer::WordFrequencies::mapped_type, float>);
+    ASSERT(std::abs(compact_server.GetWordFrequencies(7).begin()->second
+        - search_server.GetWordFrequencies(7).begin()->second) < 1e-6);
+
+    for (int query_index = 0; query_index < 200; ++query_index) {
+        std::vector<int> words;
+        std::string query;
+        for (int i = 1 + next_random(3); i > 0; --i) {
+            words.push_back(next_random(vocabulary_size / 2));
+            query += "w"s + std::to_string(words.back()) + " "s;
+        }
+        std::vector<Document> expected;
+        for (int id = 0; id < document_count; ++id) {
+            double relevance = 0.0;
+            bool matched = false;
+            for (const int word : std::set<int>(words.begin(), words.end())) {
+                const auto term_freq = document_word_freqs[id].find(word);
+                if (term_freq != document_word_freqs[id].end()) {
+                    relevance += term_freq->second * std::log(document_count * 1.0 / word_document_freqs.at(word));
+                    matched = true;
+                }
+            }
+            if (matched) {
+                expected.push_back({ id, relevance, ratings[id] });
+            }
+        }
+        SearchServer::KeepTopDocuments(expected);
+
+        for (const auto& found : { search_server.FindTopDocuments(query), compact_server.FindTopDocuments(query) }) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < SearchServer::COMPARISON_ACCURACY_FOR_DOUBLE,
+                    "Relevance at each rank must match the double reference"s);
+                const bool near_tie = (i > 0 && std::abs(expected[i].relevance - expected[i - 1].relevance) < 1e-5)
+                    || (i + 1 < expected.size() && std::abs(expected[i].relevance - expected[i + 1].relevance) < 1e-5);
+                if (!near_tie) {
+                    ASSERT_EQUAL(found[i].id, expected[i].id);
+                }
+            }
+        }
+    }
+}
+
+void TestPrefixQueries() {
+    {
+        //        ,      
+        std::vector<std::string> words;
+        for (int i = 0; i < 500; ++i) {
+            words.push_back("w"s + std::to_string(i * 7 % 500));
+        }
+        words.push_back("pet"s);
+        words.push_back("petal"s);
+        words.push_back("peter"s);
+        std::sort(words.begin(), words.end());
+        const std::vector<std::string_view> terms(words.begin(), words.end());
+        const TermDictionary dictionary(terms);
+        ASSERT_EQUAL(dictionary.GetTermCount(), words.size());
+        for (size_t i = 0; i < words.size(); i += 13) {
+            ASSERT_EQUAL(dictionary.GetTerm(i), words[i]);
+        }
+        for (const std::string& prefix : { "pet"s, "w1"s, "w49"s, "w"s, "x"s, "a"s, "w499"s }) {
+            const size_t first = std::lower_bound(words.begin(), words.end(), prefix) - words.begin();
+            size_t last = first;
+            while (last < words.size() && words[last].compare(0, prefix.size(), prefix) == 0) {
+                ++last;
+            }
+            const auto range = dictionary.FindPrefixRange(prefix);
+            ASSERT_EQUAL(range.first, first);
+            ASSERT_EQUAL(range.second, last);
+        }
+        ASSERT(dictionary.GetMemoryUsage() < words.size() * 4);
+    }
+
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7 });
+    search_server.AddDocument(2, "peter the cat"s, DocumentStatus::ACTUAL, { 5 });
+    search_server.AddDocument(3, "petal of a flower"s, DocumentStatus::ACTUAL, { 3 });
+    search_server.AddDocument(4, "grey dog"s, DocumentStatus::ACTUAL, { 1 });
+
+    // pet*   pet, petal, peter       
+    const auto found = search_server.FindTopDocuments("pet*"s);
+    const auto expected = search_server.FindTopDocuments("pet petal peter"s);
+    ASSERT_EQUAL(found.size(), 3u);
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL(found[i].id, expected[i].id);
+        ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments("pet* -peter*"s).size(), 2u);
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("pe* dog"s, 2)), (std::vector<std::string>{ "peter"s }));
+    ASSERT(search_server.FindTopDocuments("xyz*"s).empty());
+
+    //       
+    search_server.SetMaxPrefixExpansions(2);
+    std::set<int> limited_ids;
+    for (const Document& document : search_server.FindTopDocuments("pet*"s)) {
+        limited_ids.insert(document.id);
+    }
+    ASSERT_EQUAL(limited_ids, (std::set<int>{ 1, 3 }));
+
+    //      
+    search_server.SetMaxPrefixExpansions(SearchServer::DEFAULT_MAX_PREFIX_EXPANSIONS);
+    search_server.RemoveDocument(3);
+    search_server.AddDocument(5, "petunia"s, DocumentStatus::ACTUAL, { 1 });
+    std::set<int> ids;
+    for (const Document& document : search_server.FindTopDocuments("pet*"s)) {
+        ids.insert(document.id);
+    }
+    ASSERT_EQUAL(ids, (std::set<int>{ 1, 2, 5 }));
+
+    //      :        
+    //     ;        
+    SearchServer tag_server(""s);
+    tag_server.SetMaxPrefixExpansions(100000);
+    std::set<int> live_ids;
+    const auto check_expansions = [&tag_server, &live_ids]() {
+        for (const std::string& prefix : { "tag1"s, "tag15"s, "tag2"s, "tag"s }) {
+            std::set<int> expected_ids;
+            for (const int id : live_ids) {
+                if (("tag"s + std::to_string(id)).compare(0, prefix.size(), prefix) == 0) {
+                    expected_ids.insert(id);
+                }
+            }
+            std::set<int> found_ids;
+            tag_server.ForEachMatchedDocument(prefix + "*"s, [&found_ids](const Document& document) {
+                found_ids.insert(document.id);
+                });
+            ASSERT_EQUAL(found_ids, expected_ids);
+        }
+    };
+    for (int id = 0; id < 1600; ++id) {
+        tag_server.AddDocument(id, "tag"s + std::to_string(id), DocumentStatus::ACTUAL, { 1 });
+        live_ids.insert(id);
+        if (id % 3 == 0 && id > 0) {
+            tag_server.RemoveDocument(id / 2);
+            live_ids.erase(id / 2);
+        }
+        if (id % 200 == 50) {
+            check_expansions();
+        }
+    }
+    check_expansions();
+
+    bool thrown = false;
+    try {
+        search_server.FindTopDocuments("cat -*"s);
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestMemoryStats() {
+    SearchServer search_server("and"s);
+    const IndexMemoryStats empty_stats = search_server.GetMemoryStats();
+    ASSERT_EQUAL(empty_stats.vocabulary_size, 0u);
+    ASSERT_EQUAL(empty_stats.postings_bytes, 0u);
+
+    for (int id = 0; id < 100; ++id) {
+        search_server.AddDocument(id, "cat and dog word"s + std::to_string(id) + " cat"s, DocumentStatus::ACTUAL, { 1 });
+    }
+    const IndexMemoryStats stats = search_server.GetMemoryStats();
+    //    3  : cat, dog  
+    ASSERT_EQUAL(stats.document_count, 100u);
+    ASSERT_EQUAL(stats.vocabulary_size, 102u);
+    ASSERT_EQUAL(stats.posting_count, 300u);
+    ASSERT(std::abs(stats.average_posting_length - 300.0 / 102) < 1e-9);
+    ASSERT(stats.postings_bytes >= 300 * sizeof(PostingList<double>::value_type));
+    ASSERT(stats.dictionary_bytes > 0 && stats.forward_index_bytes > 0 && stats.metadata_bytes > 0);
+    ASSERT_EQUAL(stats.cache_bytes, 0u);
+    ASSERT_EQUAL(stats.total_bytes, stats.dictionary_bytes + stats.postings_bytes + stats.forward_index_bytes
+        + stats.metadata_bytes + stats.impact_order_bytes + stats.cache_bytes + stats.allocator_overhead_bytes);
+
+    search_server.FindTopDocuments("word1*"s);
+    ASSERT(search_server.GetMemoryStats().cache_bytes > 0);
+
+    for (int id = 0; id < 100; ++id) {
+        search_server.RemoveDocument(id);
+    }
+    const IndexMemoryStats removed_stats = search_server.GetMemoryStats();
+    ASSERT_EQUAL(removed_stats.posting_count, 0u);
+    ASSERT_EQUAL(removed_stats.vocabulary_size, 0u);
+    ASSERT_EQUAL(removed_stats.dictionary_bytes, 0u);
+    ASSERT_EQUAL(removed_stats.postings_bytes, 0u);
+    ASSERT_EQUAL(removed_stats.forward_index_bytes, 0u);
+    ASSERT_EQUAL(removed_stats.cache_bytes, 0u);
+}
+
+void TestMinusWordPrefiltering() {
+    SearchServer search_server(""s);
+    for (int id = 0; id < 10000; ++id) {
+        search_server.AddDocument(id, id % 2 == 0 ? "cat dog"s : "cat fox"s, DocumentStatus::ACTUAL, { id % 7 });
+    }
+    const auto count_matches = [&search_server](const std::string& query) {
+        const auto documents = search_server.FindDocumentPages(query).NextPage(20000).documents;
+        for (const Document& document : documents) {
+            ASSERT(document.id % 2 == 1 || document.id == 0);
+        }
+        return documents.size();
+    };
+
+    //  dog 5000 ,      
+    ASSERT_EQUAL(count_matches("cat -dog"s), 5000u);
+    const size_t cache_bytes = search_server.GetMemoryStats().cache_bytes;
+    ASSERT(cache_bytes > 0);
+    ASSERT_EQUAL(count_matches("cat -dog"s), 5000u);
+    ASSERT_EQUAL(search_server.GetMemoryStats().cache_bytes, cache_bytes);
+    for (const Document& document : search_server.FindTopDocuments("cat fox -dog"s)) {
+        ASSERT(document.id % 2 == 1);
+    }
+    for (const Document& document : search_server.FindTopDocuments("cat -dog"s, RatingRange{ 3, 3 })) {
+        ASSERT(document.id % 2 == 1 && document.rating == 3);
+    }
+
+    //      
+    search_server.RemoveDocument(0);
+    search_server.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(10000, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(count_matches("cat -dog"s), 5001u);
+    const auto matched = search_server.FindTopDocuments("cat -dog"s, [](int document_id, DocumentStatus, int) {
+        return document_id == 0 || document_id == 10000;
+        });
+    ASSERT_EQUAL(matched.size(), 1u);
+    ASSERT_EQUAL(matched[0].id, 0);
+}
+
+void TestScoreAccumulator() {
+    ScoreAccumulator<double> accumulator;
+    accumulator.Reset(10);
+    accumulator.Add(7, 0.5);
+    accumulator.Add(2, 1.0);
+    accumulator.Add(7, 0.25);
+    ASSERT_EQUAL(accumulator.GetTouched(), std::vector<int>({ 7, 2 }));
+    ASSERT_EQUAL(accumulator.Get(7), 0.75);
+
+    //      ,   
+    accumulator.Reset(20);
+    ASSERT(accumulator.GetTouched().empty());
+    accumulator.Add(7, 2.0);
+    accumulator.Add(15, 1.0);
+    ASSERT_EQUAL(accumulator.Get(7), 2.0);
+    ASSERT_EQUAL(accumulator.GetTouched().size(), 2u);
+
+    //       
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, { 2 });
+    search_server.AddDocument(3, "dog bird"s, DocumentStatus::ACTUAL, { 3 });
+    const auto expected = search_server.FindTopDocuments("cat dog"s);
+    const auto documents = search_server.FindTopDocuments("cat dog"s, [&search_server](int document_id, DocumentStatus, int) {
+        return !search_server.FindTopDocuments("bird"s, [document_id](int id, DocumentStatus, int) {
+            return id == document_id;
+            }).empty() || document_id != 3;
+        });
+    ASSERT_EQUAL(documents.size(), expected.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ASSERT_EQUAL(documents[i].id, expected[i].id);
+        ASSERT(std::abs(documents[i].relevance - expected[i].relevance) < 1e-9);
+    }
+}
+
+void TestBatchQueries() {
+    SearchServer search_server("and"s);
+    const std::vector<std::string> words = { "cat"s, "dog"s, "grey"s, "white"s, "fluffy"s, "tail"s };
+    for (int id = 0; id < 500; ++id) {
+        std::string text;
+        for (size_t word = 0; word < words.size(); ++word) {
+            if ((id + 1) % (word + 2) == 0) {
+                text += words[word] + " "s;
+            }
+        }
+        search_server.AddDocument(id, text + "and pet"s, id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 11 });
+    }
+
+    //    ,  ,  -   
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 40; ++i) {
+        queries.push_back(words[i % words.size()] + " "s + words[(i * 7 + 1) % words.size()]
+            + (i % 3 == 0 ? " -"s + words[(i + 2) % words.size()] : " pet"s) + (i % 4 == 0 ? " parrot"s : ""s));
+    }
+    queries.push_back("-cat"s);
+    queries.push_back("parrot"s);
+
+    const auto check = [&](const std::vector<std::vector<Document>>& results, auto find_one) {
+        ASSERT_EQUAL(results.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const std::vector<Document> expected = find_one(queries[i]);
+            ASSERT_EQUAL_HINT(results[i].size(), expected.size(), queries[i]);
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL_HINT(results[i][j].id, expected[j].id, queries[i]);
+                ASSERT(std::abs(results[i][j].relevance - expected[j].relevance) < 1e-9);
+            }
+        }
+    };
+    check(search_server.FindTopDocumentsBatch(queries), [&](const std::string& query) {
+        return search_server.FindTopDocuments(query);
+        });
+    check(search_server.FindTopDocumentsBatch(queries, DocumentStatus::BANNED), [&](const std::string& query) {
+        return search_server.FindTopDocuments(query, DocumentStatus::BANNED);
+        });
+    const auto odd_rating = [](int, DocumentStatus, int rating) { return rating % 2 == 1; };
+    check(search_server.FindTopDocumentsBatch(queries, odd_rating), [&](const std::string& query) {
+        return search_server.FindTopDocuments(query, odd_rating);
+        });
+    ASSERT(search_server.FindTopDocumentsBatch({}).empty());
+}
+
+void TestSearchBudget() {
+    SearchServer search_server(""s);
+    for (int id = 0; id < 5000; ++id) {
+        search_server.AddDocument(id, id % 1000 == 0 ? "cat rare"s : "cat"s, DocumentStatus::ACTUAL, { id % 10 });
+    }
+
+    //  :       
+    const auto expected = search_server.FindTopDocuments("cat rare"s);
+    const BudgetedResult full = search_server.FindTopDocuments("cat rare"s, SearchBudget{});
+    ASSERT(!full.is_partial);
+    ASSERT_EQUAL(full.visited_postings, 5005u);
+    ASSERT_EQUAL(full.documents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(full.documents[i].id, expected[i].id);
+    }
+
+    //    ,        
+    SearchBudget small_budget;
+    small_budget.max_postings = 100;
+    const BudgetedResult partial = search_server.FindTopDocuments("cat rare"s, small_budget);
+    ASSERT(partial.is_partial);
+    ASSERT_EQUAL(partial.visited_postings, 100u);
+    ASSERT_EQUAL(partial.documents.size(), 5u);
+    for (const Document& document : partial.documents) {
+        ASSERT_EQUAL(document.id % 1000, 0);
+    }
+
+    //      :   
+    small_budget.max_postings = 5005;
+    ASSERT(!search_server.FindTopDocuments("cat rare"s, small_budget).is_partial);
+
+    SearchBudget expired;
+    expired.deadline = SearchClock::now() - std::chrono::seconds(1);
+    const BudgetedResult late = search_server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, expired);
+    ASSERT(late.is_partial);
+    ASSERT(late.documents.empty());
+    ASSERT_EQUAL(late.visited_postings, 0u);
+
+    const BudgetedResult filtered = search_server.FindTopDocuments("rare"s, [](int, DocumentStatus, int rating) {
+        return rating == 0;
+        }, SearchBudget{});
+    ASSERT_EQUAL(filtered.documents.size(), 5u);
+}
+
+void TestDurableSearchServer() {
+    char directory_template[] = "/tmp/durable_search_serverXXXXXX";
+    const std::string directory = mkdtemp(directory_template);
+    const auto ids = [](const std::vector<Document>& documents) {
+        std::vector<int> result;
+        for (const Document& document : documents) {
+            result.push_back(document.id);
+        }
+        return result;
+    };
+
+    std::vector<int> expected;
+    {
+        DurableSearchServer search_server(directory, "and"s);
+        search_server.AddDocument(1, "white cat and fashion collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+        search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+        search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, { 5, -12, 2, 1 });
+        search_server.RemoveDocument(1);
+        search_server.RemoveDocument(100);
+        bool thrown = false;
+        try {
+            search_server.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, {});
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        expected = ids(search_server.FindTopDocuments("fluffy cat dog"s));
+    }
+
+    //       
+    {
+        DurableSearchServer search_server(directory, "and"s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 4u);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments("fluffy cat dog"s)), expected);
+        ASSERT(std::get<1>(search_server.MatchDocument("dog"s, 3)) == DocumentStatus::BANNED);
+
+        //       
+        search_server.Checkpoint();
+        search_server.AddDocument(4, "fluffy dog"s, DocumentStatus::ACTUAL, { 1 });
+    }
+
+    //      
+    {
+        std::ofstream log(directory + "/log"s, std::ios::binary | std::ios::app);
+        log << "\x40\x00\x00\x00garbage"s;
+    }
+    {
+        DurableSearchServer search_server(directory, "and"s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 1u);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+        const auto documents = search_server.FindTopDocuments("fluffy cat"s);
+        ASSERT_EQUAL(documents.size(), 2u);
+        ASSERT_EQUAL(documents[0].id, 2);
+        ASSERT_EQUAL(documents[0].rating, 5);
+
+        //      
+        std::vector<std::thread> writers;
+        for (int writer = 0; writer < 4; ++writer) {
+            writers.emplace_back([&search_server, writer] {
+                for (int i = 0; i < 25; ++i) {
+                    search_server.AddDocument(100 + writer * 25 + i, "parrot"s, DocumentStatus::ACTUAL, { i });
+                }
+                });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+    }
+    {
+        DurableSearchServer search_server(directory, "and"s);
+        ASSERT_EQUAL(search_server.GetReplayedCount(), 101u);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 103);
+        ASSERT_EQUAL(search_server.FindTopDocuments("parrot"s).size(), 5u);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void TestDuplicatePolicy() {
+    const std::vector<int> ratings = { 1, 2, 3 };
+    {
+        SearchServer search_server("and with"s);
+        search_server.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+        search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+        search_server.AddDocument(2, "fluffy grey dog"s, DocumentStatus::ACTUAL, ratings);
+        //    ,   -  
+        search_server.AddDocument(3, "dog and grey fluffy dog"s, DocumentStatus::BANNED, ratings);
+        search_server.AddDocument(4, "cat in the city with"s, DocumentStatus::ACTUAL, ratings);
+        search_server.AddDocument(5, "funny fluffy fox"s, DocumentStatus::ACTUAL, ratings);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+        ASSERT(!search_server.HasDocument(3) && !search_server.HasDocument(4));
+        ASSERT(search_server.GetDuplicates() == (std::pmr::map<int, int>{ { 3, 2 }, { 4, 1 } }));
+
+        //        
+        search_server.RemoveDocument(2);
+        search_server.AddDocument(3, "grey dog fluffy"s, DocumentStatus::ACTUAL, ratings);
+        ASSERT(search_server.HasDocument(3));
+        ASSERT(search_server.GetDuplicates() == (std::pmr::map<int, int>{ { 4, 1 } }));
+        search_server.AddDocument(6, "fluffy dog grey"s, DocumentStatus::ACTUAL, ratings);
+        ASSERT(!search_server.HasDocument(6));
+        ASSERT_EQUAL(search_server.GetDuplicates().at(6), 3);
+
+        //    
+        SearchServer source("and with"s);
+        source.AddDocument(7, "funny fox fluffy"s, DocumentStatus::ACTUAL, ratings);
+        search_server.CopyDocumentFrom(source, 7);
+        ASSERT(!search_server.HasDocument(7));
+        ASSERT_EQUAL(search_server.GetDuplicates().at(7), 5);
+    }
+    {
+        //   RECORD  
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
+        search_server.AddDocument(2, "city cat"s, DocumentStatus::ACTUAL, ratings);
+        search_server.SetDuplicatePolicy(DuplicatePolicy::RECORD);
+        search_server.AddDocument(3, "the city in cat"s, DocumentStatus::ACTUAL, ratings);
+        search_server.AddDocument(4, "city and cat"s, DocumentStatus::ACTUAL, ratings);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 4);
+        ASSERT(search_server.GetDuplicates() == (std::pmr::map<int, int>{ { 3, 1 }, { 4, 2 } }));
+        search_server.RemoveDocument(3);
+        search_server.RemoveDocument(1);
+        ASSERT(search_server.GetDuplicates() == (std::pmr::map<int, int>{ { 4, 2 } }));
+        search_server.AddDocument(5, "in the city cat"s, DocumentStatus::ACTUAL, ratings);
+        ASSERT(search_server.GetDuplicates().count(5) == 0);
+
+        search_server.SetDuplicatePolicy(DuplicatePolicy::ALLOW);
+        search_server.AddDocument(6, "in the city cat"s, DocumentStatus::ACTUAL, ratings);
+        ASSERT(search_server.GetDuplicates().count(6) == 0);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 4);
+    }
+}
+
+void TestImpactOrder() {
+    const std::vector<std::string> words = { "cat"s, "dog"s, "grey"s, "white"s, "fluffy"s, "tail"s, "parrot"s };
+    const auto make_text = [&words](int id) {
+        std::string text;
+        for (size_t word = 0; word < words.size(); ++word) {
+            const int count = static_cast<int>((id * (word + 7) / 3 + word) % (word < 3 ? 4 : 30));
+            for (int i = 0; i < std::min(count, 3); ++i) {
+                text += words[word] + " "s;
+            }
+        }
+        return text + std::string(id % 7 * 2, 'a') + " and pet"s;
+    };
+    const auto make_status = [](int id) {
+        return id % 23 == 0 ? DocumentStatus::BANNED : id % 5 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+    };
+
+    SearchServer plain("and"s);
+    SearchServer ordered("and"s);
+    ordered.SetImpactOrderThreshold(100);
+    for (int id = 0; id < 2000; ++id) {
+        plain.AddDocument(id, make_text(id), make_status(id), { id % 13 });
+        ordered.AddDocument(id, make_text(id), make_status(id), { id % 13 });
+    }
+    ASSERT(ordered.GetMemoryStats().impact_order_bytes > 0);
+    ASSERT_EQUAL(plain.GetMemoryStats().impact_order_bytes, 0u);
+
+    const std::vector<std::string> queries = { "cat"s, "dog"s, "pet"s, "tail"s, "parrot"s, "cat dog"s, "grey pet"s,
+        "cat -dog"s, "pet -tail"s, "white fluffy"s, "cat parrot"s, "dog tail -grey"s, "fox"s, "-cat"s };
+    const auto odd_rating = [](int, DocumentStatus, int rating) { return rating % 2 == 1; };
+    const auto check = [&]() {
+        for (const std::string& query : queries) {
+            const auto compare = [&query](const std::vector<Document>& actual, const std::vector<Document>& expected) {
+                ASSERT_EQUAL_HINT(actual.size(), expected.size(), query);
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ASSERT_EQUAL_HINT(actual[i].id, expected[i].id, query);
+                    ASSERT(std::abs(actual[i].relevance - expected[i].relevance) < 1e-9);
+                }
+            };
+            compare(ordered.FindTopDocuments(query), plain.FindTopDocuments(query));
+            compare(ordered.FindTopDocuments(query, DocumentStatus::BANNED), plain.FindTopDocuments(query, DocumentStatus::BANNED));
+            compare(ordered.FindTopDocuments(query, DocumentStatus::REMOVED), plain.FindTopDocuments(query, DocumentStatus::REMOVED));
+            compare(ordered.FindTopDocuments(query, odd_rating), plain.FindTopDocuments(query, odd_rating));
+            const auto predicate = StatusEquals{ DocumentStatus::IRRELEVANT } && RatingRange{ 3, 8 };
+            compare(ordered.FindTopDocuments(query, predicate), plain.FindTopDocuments(query, predicate));
+        }
+    };
+    check();
+
+    //        
+    for (int id = 0; id < 2000; id += 3) {
+        plain.RemoveDocument(id);
+        ordered.RemoveDocument(id);
+    }
+    check();
+    for (int id = 2000; id < 2600; ++id) {
+        plain.AddDocument(id, make_text(id * 7), make_status(id), { id % 17 });
+        ordered.AddDocument(id, make_text(id * 7), make_status(id), { id % 17 });
+    }
+    check();
+
+    ordered.SetImpactOrderThreshold(0);
+    ASSERT_EQUAL(ordered.GetMemoryStats().impact_order_bytes, 0u);
+    check();
+}
+
+void TestEndpointParse() {
+    ASSERT_EQUAL(Endpoint::Parse("tcp:localhost:8080"s).port, 8080);
+    ASSERT_EQUAL(Endpoint::Parse("127.0.0.1:65535"s).port, 65535);
+    ASSERT_EQUAL(Endpoint::Parse("tcp:127.0.0.1:0"s).port, 0);
+    //         
+    for (const std::string& text : { "tcp:host:65536"s, "tcp:host:-1"s, "tcp:host:"s, "tcp:host:80x"s, "tcp:host: 80"s,
+        "tcp:host:99999999999"s }) {
+        bool thrown = false;
+        try {
+            Endpoint::Parse(text);
+        }
+        catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, text);
+    }
+
+    // ,   , Listen  ;    
+    char directory_template[] = "/tmp/socket_ioXXXXXX";
+    const std::string directory = mkdtemp(directory_template);
+    Endpoint endpoint = Endpoint::Parse("unix:"s + directory + "/file"s);
+    std::ofstream(endpoint.unix_path) << "data"s;
+    bool thrown = false;
+    try {
+        Listen(endpoint);
+    }
+    catch (const SocketError&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT(std::filesystem::is_regular_file(endpoint.unix_path));
+
+    endpoint = Endpoint::Parse("unix:"s + directory + "/socket"s);
+    {
+        Socket listener = Listen(endpoint);
+        thrown = false;
+        try {
+            Listen(endpoint);
+        }
+        catch (const SocketError&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    ASSERT(std::filesystem::is_socket(endpoint.unix_path));
+    Socket listener = Listen(endpoint);
+    ASSERT(listener.IsOpen());
+    std::filesystem::remove_all(directory);
+}
+
 //  TestSearchServer      
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -347,6 +1565,28 @@ void TestSearchServer() {
     RUN_TEST(TestPaginator);
     RUN_TEST(Test_RequestQueue);
     RUN_TEST(Test_RemoveDuplicates);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestQueryArena);
+    RUN_TEST(TestQueryContext);
+    RUN_TEST(TestIndexPredicates);
+    RUN_TEST(TestAsyncQueries);
+    RUN_TEST(TestSegmentedSearchServer);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestShardCoordinator);
+    RUN_TEST(TestQueryServer);
+    RUN_TEST(TestSearchAfterPagination);
+    RUN_TEST(TestStreamingResults);
+    RUN_TEST(TestPostingStorageMode);
+    RUN_TEST(TestPrefixQueries);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestMinusWordPrefiltering);
+    RUN_TEST(TestScoreAccumulator);
+    RUN_TEST(TestBatchQueries);
+    RUN_TEST(TestSearchBudget);
+    RUN_TEST(TestDurableSearchServer);
+    RUN_TEST(TestDuplicatePolicy);
+    RUN_TEST(TestImpactOrder);
+    RUN_TEST(TestEndpointParse);
 
     std::cout << std::endl;
 }
@@ -113,6 +113,28 @@ void TestRelevanceComputing();
 void TestPaginator();
 void Test_RequestQueue();
 void Test_RemoveDuplicates();
+void TestRemoveDocument();
+void TestQueryArena();
+void TestQueryContext();
+void TestIndexPredicates();
+void TestAsyncQueries();
+void TestSegmentedSearchServer();
+void TestShardedSearchServer();
+void TestShardCoordinator();
+void TestQueryServer();
+void TestSearchAfterPagination();
+void TestStreamingResults();
+void TestPostingStorageMode();
+void TestPrefixQueries();
+void TestMemoryStats();
+void TestMinusWordPrefiltering();
+void TestScoreAccumulator();
+void TestBatchQueries();
+void TestSearchBudget();
+void TestDurableSearchServer();
+void TestDuplicatePolicy();
+void TestImpactOrder();
+void TestEndpointParse();
 
 //  TestSearchServer      
 void TestSearchServer();
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "thread_pool.h"
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_queue_index = 0;
+
+// Returns 0 or the error code of pthread_setaffinity_np
+int PinThread(std::thread& thread, int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return EINVAL;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    return 0;
+#endif
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count)
+    : ThreadPool(ThreadPoolOptions{ thread_count, {} }) {
+}
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options) {
+    const size_t thread_count = options.thread_count > 0
+        ? options.thread_count
+        : std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t index = 0; index < thread_count; ++index) {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t index = 0; index < thread_count; ++index) {
+        threads_.emplace_back([this, index] {
+            WorkerLoop(index);
+            });
+        if (options.cpus.empty()) {
+            continue;
+        }
+        const int cpu = options.cpus[index % options.cpus.size()];
+        if (const int error = PinThread(threads_.back(), cpu); error != 0) {
+            Stop();
+            throw std::runtime_error("Cannot pin a worker to CPU " + std::to_string(cpu) + ": " + std::strerror(error));
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard guard(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+    size_t queue_index = GetCurrentQueueIndex();
+    if (queue_index == queues_.size()) {
+        queue_index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    }
+    // The task is counted before it becomes visible: a thief may run it and decrement
+    // the counter before this thread would get to increment it
+    {
+        std::lock_guard guard(wake_mutex_);
+        ++pending_tasks_;
+    }
+    {
+        std::lock_guard guard(queues_[queue_index]->mutex);
+        queues_[queue_index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::TryRunPendingTask() {
+    const size_t own_index = GetCurrentQueueIndex();
+    std::function<void()> task;
+    if (own_index < queues_.size()) {
+        auto& queue = *queues_[own_index];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+    for (size_t offset = 1; !task && offset <= queues_.size(); ++offset) {
+        auto& queue = *queues_[(own_index + offset) % queues_.size()];
+        std::lock_guard guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    {
+        std::lock_guard guard(wake_mutex_);
+        --pending_tasks_;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    current_pool = this;
+    current_queue_index = index;
+    while (true) {
+        if (TryRunPendingTask()) {
+            continue;
+        }
+        std::unique_lock lock(wake_mutex_);
+        wake_.wait(lock, [this] {
+            return stopping_ || pending_tasks_ > 0;
+            });
+        if (stopping_ && pending_tasks_ == 0) {
+            return;
+        }
+    }
+}
+
+size_t ThreadPool::GetCurrentQueueIndex() const {
+    return current_pool == this ? current_queue_index : queues_.size();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct ThreadPoolOptions {
+    // 0 means one thread per hardware thread
+    size_t thread_count = 0;
+    // If not empty, worker i is pinned to cpus[i % cpus.size()] (Linux only, ignored elsewhere).
+    // The constructor throws std::runtime_error if a worker can't be pinned.
+    std::vector<int> cpus;
+};
+
+// Work-stealing executor: every worker owns a task deque, takes its own tasks from the back
+// and steals from the front of the other deques when it runs out of work.
+// Tasks posted from a worker go to its own deque, tasks from other threads are spread round-robin.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = 0);
+
+    explicit ThreadPool(const ThreadPoolOptions& options);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Finishes all queued tasks before joining the workers
+    ~ThreadPool();
+
+    size_t GetThreadCount() const;
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task);
+
+    // Calls function(i) for i in [0, count) and waits for all of them. The calling thread runs
+    // part of the work and helps with other queued tasks, and sleeps only when there is nothing
+    // to help with, so it is safe to call from inside a task. The first exception thrown is
+    // rethrown after all calls finish.
+    template <typename Function>
+    void ParallelFor(size_t count, const Function& function);
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    size_t pending_tasks_ = 0;
+    bool stopping_ = false;
+    std::atomic<size_t> next_queue_{ 0 };
+
+    void Post(std::function<void()> task);
+
+    // Runs one queued task, if there is any; returns false when all queues are empty
+    bool TryRunPendingTask();
+
+    void WorkerLoop(size_t index);
+
+    // Stops the workers once the queues are empty and joins them
+    void Stop();
+
+    // Index of the current thread's queue, or queues_.size() for threads outside the pool
+    size_t GetCurrentQueueIndex() const;
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> ThreadPool::Submit(Task task) {
+    auto packaged_task = std::make_shared<std::packaged_task<std::invoke_result_t<Task>()>>(std::move(task));
+    auto result = packaged_task->get_future();
+    Post([packaged_task] {
+        (*packaged_task)();
+        });
+    return result;
+}
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, const Function& function) {
+    if (count == 0) {
+        return;
+    }
+    std::atomic<size_t> remaining{ count };
+    std::mutex exception_mutex;
+    std::exception_ptr first_exception;
+    const auto run = [&](size_t index) {
+        try {
+            function(index);
+        }
+        catch (...) {
+            std::lock_guard guard(exception_mutex);
+            if (!first_exception) {
+                first_exception = std::current_exception();
+            }
+        }
+        // The caller may return as soon as the count drops to zero, taking this closure with it
+        ThreadPool& pool = *this;
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            {
+                std::lock_guard guard(pool.wake_mutex_);
+            }
+            pool.wake_.notify_all();
+        }
+    };
+
+    for (size_t index = 1; index < count; ++index) {
+        Post([&run, index] {
+            run(index);
+            });
+    }
+    run(0);
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (TryRunPendingTask()) {
+            continue;
+        }
+        // The rest is being run by other threads: wait for the last call or for new work to help with
+        std::unique_lock lock(wake_mutex_);
+        wake_.wait(lock, [this, &remaining] {
+            return remaining.load(std::memory_order_acquire) == 0 || pending_tasks_ > 0;
+            });
+    }
+    if (first_exception) {
+        std::rethrow_exception(first_exception);
+    }
+}
@@ -0,0 +1,43 @@
+// Shard process for ShardCoordinator. Build together with the search-server sources except main.cpp:
+//     g++ -std=c++20 -O2 -pthread -I../search-server main.cpp $(ls ../search-server/*.cpp | grep -v /main.cpp)
+// Usage: shard-server tcp:HOST:PORT|unix:PATH ["stop words"]
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "search_server.h"
+#include "shard_server.h"
+
+namespace {
+
+ShardServer* running_server = nullptr;
+
+void HandleStopSignal(int) {
+    if (running_server) {
+        running_server->Stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " tcp:HOST:PORT|unix:PATH [\"stop words\"]" << std::endl;
+        return 1;
+    }
+    try {
+        SearchServer search_server(std::string(argc == 3 ? argv[2] : ""));
+        ShardServer shard_server(search_server, Endpoint::Parse(argv[1]));
+        running_server = &shard_server;
+        std::signal(SIGINT, HandleStopSignal);
+        std::signal(SIGTERM, HandleStopSignal);
+        std::cout << "Listening on " << shard_server.GetEndpoint().ToString() << std::endl;
+        shard_server.Serve();
+        running_server = nullptr;
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+}